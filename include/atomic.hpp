@@ -1,6 +1,9 @@
 #pragma once
+#include <assert.hpp>
 #include <basic_types.hpp>
+#include <chrono.hpp>
 #include <crt_attributes.hpp>
+#include <heap.hpp>
 #include <irql.hpp>
 #include <intrinsic.hpp>
 #include <limits.hpp>
@@ -27,43 +30,37 @@ inline void make_compiler_barrier() noexcept {
   _ReadWriteBarrier();
 }
 
-class universal_lock : non_relocatable {
- public:
-  universal_lock() noexcept {
-    KeInitializeSpinLock(addressof(m_spinlock));
-    KeInitializeMutex(addressof(m_mtx), 0);
-  }
-
-  void lock() {
-    if (get_current_irql() < DISPATCH_LEVEL) {
-      KeWaitForSingleObject(addressof(m_mtx), Executive, KernelMode, false,
-                            nullptr);
-    } else {
-      KeAcquireSpinLockAtDpcLevel(addressof(m_spinlock));
-    }
-  }
-
-  void unlock() {
-    if (get_current_irql() < DISPATCH_LEVEL) {
-      KeReleaseMutex(addressof(m_mtx), false);
-    } else {
-      KeReleaseSpinLockFromDpcLevel(addressof(m_spinlock));
-    }
-  }
+// Non-lock-free atomics share a global table of cache-padded spinlocks
+// indexed by address hash, so they keep their natural size. Unlike a mutex
+// the stripes raise IRQL to DISPATCH_LEVEL, hence such atomics can't live in
+// paged memory
+inline constexpr size_t ATOMIC_LOCK_STRIPE_COUNT{64};
 
- private:
-  KMUTEX m_mtx;
-  KSPIN_LOCK m_spinlock;
+struct alignas(crt::CACHE_LINE_SIZE) atomic_lock_stripe {
+  KSPIN_LOCK spinlock;  // Zero-initialized KSPIN_LOCK is released
 };
 
-template <class Lock>
-class auto_lock {
+inline atomic_lock_stripe atomic_lock_table[ATOMIC_LOCK_STRIPE_COUNT]{};
+
+class striped_lock_guard : non_relocatable {
  public:
-  auto_lock(Lock& lock) noexcept : m_lock{lock} { m_lock.lock(); }
-  ~auto_lock() { m_lock.unlock(); }
+  explicit striped_lock_guard(const volatile void* address) noexcept
+      : m_spinlock{addressof(get_stripe(address).spinlock)},
+        m_prev_irql{KeAcquireSpinLockRaiseToDpc(m_spinlock)} {}
+
+  ~striped_lock_guard() noexcept { KeReleaseSpinLock(m_spinlock, m_prev_irql); }
+
+ private:
+  static atomic_lock_stripe& get_stripe(const volatile void* address) noexcept {
+    auto hash{reinterpret_cast<uintptr_t>(address)};
+    hash ^= hash >> 17;  // Neighbouring objects mustn't share a stripe
+    hash >>= 4;          // Minimal allocation alignment
+    return atomic_lock_table[hash % ATOMIC_LOCK_STRIPE_COUNT];
+  }
 
  private:
-  Lock& m_lock;
+  KSPIN_LOCK* m_spinlock;
+  KIRQL m_prev_irql;
 };
 
 }  // namespace th::details
@@ -244,13 +241,11 @@ struct atomic_padded {
 template <class Ty>
 struct atomic_storage_selector {
   using storage_type = atomic_padded<Ty>;
-  using lock_type = universal_lock;
 };
 
 template <class Ty>
 struct atomic_storage_selector<Ty&> {
   using storage_type = Ty&;
-  using lock_type = universal_lock;
 };
 
 template <class Ty, size_t = sizeof(remove_reference_t<Ty>)>
@@ -260,16 +255,19 @@ template <class Ty, size_t /* = ... */>
 struct atomic_storage {
   // Provides operations common to all specializations of std::atomic, load,
   // store, exchange, and CAS. Locking version used when hardware has no atomic
-  // operations for sizeof(Ty).
+  // operations for sizeof(Ty). The value is accessed under a striped spinlock
+  // at DISPATCH_LEVEL, so the object must reside in non-paged memory.
 
  public:
   using value_type = remove_reference_t<Ty>;
 
+  static_assert(is_trivially_copyable_v<value_type>,
+                "lock-based atomics copy the value at DISPATCH_LEVEL and "
+                "require a trivially copyable type");
+
  private:
-  using selector = atomic_storage_selector<Ty>;
-  using storage_t = typename selector::storage_t;
-  using lock_t = typename selector::lock_t;
-  using guard_t = auto_lock<lock_t>;
+  using storage_type = typename atomic_storage_selector<Ty>::storage_type;
+  using guard_t = striped_lock_guard;
 
  public:
   atomic_storage() noexcept(is_nothrow_default_constructible_v<Ty>) = default;
@@ -282,34 +280,34 @@ struct atomic_storage {
 
   template <memory_order order = memory_order_seq_cst>
   void store(const value_type value) noexcept {
-    guard_t guard{m_lock};
-    m_value = value;
+    guard_t guard{get_address()};
+    get_value() = value;
   }
 
   template <memory_order order = memory_order_seq_cst>
   [[nodiscard]] value_type load() const noexcept {
     // load with sequential consistency
-    guard_t guard{m_lock};
-    value_type local_copy{m_value};
+    guard_t guard{get_address()};
+    value_type local_copy{get_value()};
     return local_copy;
   }
 
   template <memory_order order = memory_order_seq_cst>
   value_type exchange(const value_type new_value) noexcept {
-    guard_t guard{m_lock};
-    value_type old_value{m_value};
-    m_value = new_value;
+    guard_t guard{get_address()};
+    value_type old_value{get_value()};
+    get_value() = new_value;
     return old_value;
   }
 
   template <memory_order order = memory_order_seq_cst>
   bool compare_exchange_strong(value_type& expected,
                                const value_type desired) noexcept {  // CAS
-    const auto* target_ptr = addressof(m_value);
-    const auto* expected_ptr = addressof(expected);
+    auto* target_ptr{get_address()};
+    auto* expected_ptr{addressof(expected)};
     bool matched;
 
-    guard_t guard{m_lock};
+    guard_t guard{target_ptr};
     matched = memcmp(target_ptr, expected_ptr, sizeof(value_type)) == 0;
     if (matched) {
       memcpy(target_ptr, addressof(desired), sizeof(value_type));
@@ -319,22 +317,29 @@ struct atomic_storage {
     return matched;
   }
 
- public:
-  storage_t m_value{};
-
  private:
-  mutable lock_t m_lock{};
+  value_type& get_value() const noexcept {
+    if constexpr (is_reference_v<Ty>) {
+      return m_value;
+    } else {
+      return m_value.value;
+    }
+  }
+
+  value_type* get_address() const noexcept { return addressof(get_value()); }
+
+ public:
+  storage_type m_value{};
 };
 
 template <class Ty, class InterlockedPolicy>
 class interlocked_storage {
  public:
-  using value_type = Ty;
+  using value_type = remove_reference_t<Ty>;
 
  private:
   using internal_value_type = typename InterlockedPolicy::value_type;
-  using storage_type =
-      typename atomic_storage_selector<value_type>::storage_type;
+  using storage_type = typename atomic_storage_selector<Ty>::storage_type;
 
  public:
   interlocked_storage() noexcept(is_nothrow_default_constructible_v<Ty>) =
@@ -355,9 +360,17 @@ class interlocked_storage {
 
   template <>
   value_type load<memory_order_seq_cst>() const noexcept {
-    internal_value_type empty{};
-    return InterlockedPolicy::compare_exchange_strong(
-        const_cast<internal_value_type*>(get_storage()), empty, empty);
+    if constexpr (sizeof(internal_value_type) <= sizeof(uintptr_t)) {
+      // x86 and x64 are TSO and seq_cst stores are locked instructions,
+      // so a seq_cst load is a plain MOV
+      return load<memory_order_acquire>();
+    } else {
+      // 8-byte plain loads aren't atomic on x86
+      internal_value_type empty{};
+      internal_value_type result{InterlockedPolicy::compare_exchange_strong(
+          const_cast<internal_value_type*>(get_storage()), empty, empty)};
+      return reinterpret_cast<value_type&>(result);
+    }
   }
 
   template <memory_order order = memory_order_seq_cst>
@@ -478,6 +491,87 @@ DEFINE_ATOMIC_STORAGE(8)
 
 #undef DEFINE_ATOMIC_STORAGE
 
+#ifdef _M_AMD64
+template <class Ty>
+struct atomic_storage<Ty, 16> {  // cmpxchg16b, e.g. pointer and ABA counter
+ public:
+  using value_type = remove_reference_t<Ty>;
+
+ private:
+  using storage_type = typename atomic_storage_selector<Ty>::storage_type;
+
+  struct alignas(16) int128_placeholder {
+    long long low;
+    long long high;
+  };
+
+ public:
+  atomic_storage() noexcept(is_nothrow_default_constructible_v<Ty>) = default;
+
+  constexpr atomic_storage(
+      conditional_t<is_reference_v<Ty>, Ty, const value_type> value) noexcept
+      : m_value{value} {
+    // non-atomically initialize this atomic
+  }
+
+  template <memory_order order = memory_order_seq_cst>
+  void store(const value_type value) noexcept {
+    [[maybe_unused]] auto old_value{exchange(value)};
+  }
+
+  template <memory_order order = memory_order_seq_cst>
+  [[nodiscard]] value_type load() const noexcept {
+    // There is no plain 16-byte atomic load: CAS replaces 0 with 0 and
+    // returns the current value in any case
+    int128_placeholder result{};
+    InterlockedCompareExchange128(get_storage(), 0, 0, addressof(result.low));
+    return reinterpret_cast<value_type&>(result);
+  }
+
+  template <memory_order order = memory_order_seq_cst>
+  value_type exchange(const value_type new_value) noexcept {
+    value_type old_value{load()};
+    while (!compare_exchange_strong(old_value, new_value))
+      ;
+    return old_value;
+  }
+
+  template <memory_order order = memory_order_seq_cst>
+  bool compare_exchange_strong(value_type& expected,
+                               const value_type desired) noexcept {
+    int128_placeholder desired_bytes;
+    memcpy(addressof(desired_bytes), addressof(desired), sizeof(value_type));
+    int128_placeholder comparand;
+    memcpy(addressof(comparand), addressof(expected), sizeof(value_type));
+
+    const bool matched{
+        InterlockedCompareExchange128(get_storage(), desired_bytes.high,
+                                      desired_bytes.low,
+                                      addressof(comparand.low)) != 0};
+    if (!matched) {
+      memcpy(addressof(expected), addressof(comparand), sizeof(value_type));
+    }
+    return matched;
+  }
+
+ private:
+  value_type& get_value() const noexcept {
+    if constexpr (is_reference_v<Ty>) {
+      return m_value;
+    } else {
+      return m_value.value;
+    }
+  }
+
+  volatile long long* get_storage() const noexcept {
+    return atomic_address_as<long long>(get_value());
+  }
+
+ public:
+  storage_type m_value{};
+};
+#endif
+
 template <class Ty, size_t = sizeof(Ty)>
 struct atomic_integral;  // not defined
 
@@ -486,7 +580,7 @@ class interlocked_integral : public atomic_storage<Ty> {
  public:
   using MyBase = atomic_storage<Ty>;
 
-  using value_type = Ty;
+  using value_type = remove_reference_t<Ty>;
 
  private:
   using internal_value_type = typename IntegralPolicy::value_type;
@@ -549,7 +643,7 @@ template <>
 struct integral_policy<32> {
   using value_type = long;
 
-  static long add_op(volatile long* addend, long value) noexcept {
+  static long add(volatile long* addend, long value) noexcept {
     return InterlockedAdd(addend, value) - value;
   }
 
@@ -655,21 +749,27 @@ DEFINE_INTEGRAL_STORAGE(8)
 
 #undef DEFINE_INTEGRAL_STORAGE
 
+#ifdef _M_AMD64
+inline constexpr size_t MAX_LOCK_FREE_SIZE{2 * sizeof(uintmax_t)};
+#else
+inline constexpr size_t MAX_LOCK_FREE_SIZE{sizeof(uintmax_t)};
+#endif
+
 template <class Ty>
 struct is_always_lock_free {
   using value_type = Ty;
   static constexpr size_t SIZE_OF_TYPE{sizeof(Ty)};
 
-  static constexpr bool value = SIZE_OF_TYPE <= sizeof(uintmax_t) &&
+  static constexpr bool value = SIZE_OF_TYPE <= MAX_LOCK_FREE_SIZE &&
                                 (SIZE_OF_TYPE & SIZE_OF_TYPE - 1) == 0;
 };
 
 template <class Ty>
 inline constexpr bool is_always_lock_free_v = is_always_lock_free<Ty>::value;
 
-template <class Ty>
-struct integral_facade : integral_storage<Ty, sizeof(Ty)> {
-  using MyBase = integral_storage<Ty, sizeof(Ty)>;
+template <class ValueTy, class Ty = remove_reference_t<ValueTy> >
+struct integral_facade : integral_storage<ValueTy, sizeof(Ty)> {
+  using MyBase = integral_storage<ValueTy, sizeof(Ty)>;
   using difference_type = Ty;
 
   using MyBase::MyBase;
@@ -807,12 +907,9 @@ struct atomic_floating {
   static_assert(always_false_v<Ty>, "not implemented");
 };
 
-template <class Ty>
-struct atomic_pointer;
-
-template <class Ty>
-struct atomic_pointer : integral_storage<Ty, sizeof(uintptr_t)> {
-  using MyBase = integral_storage<Ty, sizeof(uintptr_t)>;
+template <class ValueTy, class Ty = remove_reference_t<ValueTy> >
+struct atomic_pointer : integral_storage<ValueTy, sizeof(uintptr_t)> {
+  using MyBase = integral_storage<ValueTy, sizeof(uintptr_t)>;
   using difference_type = ptrdiff_t;
 
   using MyBase::MyBase;
@@ -880,6 +977,21 @@ struct atomic_pointer : integral_storage<Ty, sizeof(uintptr_t)> {
 };
 }  // namespace th::details
 
+namespace th::details {
+inline constexpr uint32_t ATOMIC_WAIT_SPIN_COUNT{128};
+
+// Backed by a global hashed table of wait queues; parking is possible only
+// at IRQL <= APC_LEVEL, at DISPATCH_LEVEL waiters keep spinning. With a
+// timeout the waiter returns after the first wakeup and false on timeout;
+// at DISPATCH_LEVEL the timeout is a single bounded spin
+bool atomic_wait_address(const volatile void* address,
+                         const void* old_value,
+                         size_t size,
+                         const LARGE_INTEGER* timeout = nullptr) noexcept;
+void atomic_notify_address(const volatile void* address,
+                           bool notify_all) noexcept;
+}  // namespace th::details
+
 template <bool Cond>
 struct atomic_template_selector {
   template <class Ty1, class>
@@ -1047,14 +1159,161 @@ class atomic : public atomic_base_t<Ty>,
 
   operator Ty() const volatile noexcept { return load(); }
   operator Ty() const noexcept { return load(); }
+
+  template <memory_order order = memory_order_seq_cst>
+  void wait(const Ty old_value) const noexcept {
+    static_assert(is_integral_v<Ty> || is_pointer_v<Ty>,
+                  "waiting is supported only for integral and pointer types");
+    for (uint32_t spin = 0; spin < th::details::ATOMIC_WAIT_SPIN_COUNT;
+         ++spin) {
+      if (MyBase::load<order>() != old_value) {
+        return;
+      }
+      YieldProcessor();
+    }
+    th::details::atomic_wait_address(addressof(MyBase::m_value),
+                                     addressof(old_value), sizeof(Ty));
+  }
+
+  // Returns false on timeout. Like wait() after parking, returns after the
+  // first wakeup, so the caller must check the value again
+  template <memory_order order = memory_order_seq_cst,
+            class Clock,
+            class Duration>
+  bool wait_until(
+      const Ty old_value,
+      const chrono::time_point<Clock, Duration>& awake_time) const noexcept {
+    static_assert(is_integral_v<Ty> || is_pointer_v<Ty>,
+                  "waiting is supported only for integral and pointer types");
+    if (MyBase::load<order>() != old_value) {
+      return true;
+    }
+    const auto remaining{awake_time - Clock::now()};
+    if (remaining <= decltype(remaining)::zero()) {
+      return false;
+    }
+    LARGE_INTEGER interval;
+    interval.QuadPart =  // A negative value indicates relative time
+        -chrono::duration_cast<chrono::tics>(remaining).count();
+    return th::details::atomic_wait_address(addressof(MyBase::m_value),
+                                            addressof(old_value), sizeof(Ty),
+                                            addressof(interval));
+  }
+
+  void notify_one() noexcept {
+    th::details::atomic_notify_address(addressof(MyBase::m_value), false);
+  }
+
+  void notify_all() noexcept {
+    th::details::atomic_notify_address(addressof(MyBase::m_value), true);
+  }
 };
 
 template <class Ty>
 atomic(Ty) -> atomic<Ty>;
 
 template <class Ty>
-struct atomic_ref {
-  static_assert(always_false_v<Ty>, "not implemented");
+class atomic_ref
+    : public atomic_base_type_selector<Ty, Ty&>::type {  // non-owning atomic
+ private:
+  using MyBase = typename atomic_base_type_selector<Ty, Ty&>::type;
+
+ public:
+  using value_type = Ty;
+
+ public:
+  static constexpr bool is_always_lock_free =
+      th::details::is_always_lock_free_v<Ty>;
+
+  static constexpr size_t required_alignment =
+      is_always_lock_free && sizeof(Ty) > alignof(Ty) ? sizeof(Ty)
+                                                      : alignof(Ty);
+
+ public:
+  static_assert(is_trivially_copyable_v<Ty>,
+                "atomic_ref<Ty> requires Ty to be trivially copyable");
+
+ public:
+  explicit atomic_ref(Ty& obj) noexcept : MyBase(obj) {
+    assert_with_msg(
+        reinterpret_cast<uintptr_t>(addressof(obj)) % required_alignment == 0,
+        "object referenced by atomic_ref must be suitably aligned");
+  }
+
+  atomic_ref(const atomic_ref&) noexcept = default;
+  atomic_ref& operator=(const atomic_ref&) = delete;
+
+  [[nodiscard]] bool is_lock_free() const noexcept {
+    return is_always_lock_free;
+  }
+
+  Ty operator=(const Ty value) const noexcept {
+    store(value);
+    return value;
+  }
+
+  template <memory_order order = memory_order_seq_cst>
+  void store(const Ty value) const noexcept {
+    const_cast<atomic_ref*>(this)->MyBase::store<order>(value);
+  }
+
+  template <memory_order order = memory_order_seq_cst>
+  [[nodiscard]] Ty load() const noexcept {
+    return MyBase::load<order>();
+  }
+
+  template <memory_order order = memory_order_seq_cst>
+  Ty exchange(const Ty value) const noexcept {
+    return const_cast<atomic_ref*>(this)->MyBase::exchange<order>(value);
+  }
+
+  template <memory_order order = memory_order_seq_cst>
+  bool compare_exchange_strong(Ty& expected, const Ty desired) const noexcept {
+    return const_cast<atomic_ref*>(this)
+        ->MyBase::compare_exchange_strong<order>(expected, desired);
+  }
+
+  template <memory_order on_success, memory_order on_failure>
+  bool compare_exchange_strong(Ty& expected, const Ty desired) const noexcept {
+    return compare_exchange_strong<
+        th::details::combine_cas_memory_orders<on_success, on_failure>()>(
+        expected, desired);
+  }
+
+  template <memory_order order = memory_order_seq_cst>
+  bool compare_exchange_weak(Ty& expected, const Ty desired) const noexcept {
+    return compare_exchange_strong<order>(expected, desired);
+  }
+
+  template <memory_order on_success, memory_order on_failure>
+  bool compare_exchange_weak(Ty& expected, const Ty desired) const noexcept {
+    return compare_exchange_strong<on_success, on_failure>(expected, desired);
+  }
+
+  operator Ty() const noexcept { return load(); }
+
+  template <memory_order order = memory_order_seq_cst>
+  void wait(const Ty old_value) const noexcept {
+    static_assert(is_integral_v<Ty> || is_pointer_v<Ty>,
+                  "waiting is supported only for integral and pointer types");
+    for (uint32_t spin = 0; spin < th::details::ATOMIC_WAIT_SPIN_COUNT;
+         ++spin) {
+      if (load<order>() != old_value) {
+        return;
+      }
+      YieldProcessor();
+    }
+    th::details::atomic_wait_address(addressof(MyBase::m_value),
+                                     addressof(old_value), sizeof(Ty));
+  }
+
+  void notify_one() const noexcept {
+    th::details::atomic_notify_address(addressof(MyBase::m_value), false);
+  }
+
+  void notify_all() const noexcept {
+    th::details::atomic_notify_address(addressof(MyBase::m_value), true);
+  }
 };
 
 using atomic_bool = atomic<bool>;
@@ -1200,7 +1459,6 @@ inline void atomic_flag_clear_explicit(
   flag->clear();
 }
 
-// TODO: atomic_ref, atomic_floating, Ty& specializations for atomic_pointer and
-// atomic_integral
+// TODO: atomic_floating
 
 }  // namespace ktl
\ No newline at end of file
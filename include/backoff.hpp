@@ -0,0 +1,110 @@
+#pragma once
+#include <atomic.hpp>
+#include <basic_types.hpp>
+#include <intrinsic.hpp>
+
+#include <ntddk.h>
+
+namespace ktl {
+// Backoff policies for CAS and spin loops. A policy object lives for one
+// operation: pause() is called before every retry
+
+namespace th::details {
+class backoff_base {
+ public:
+  [[nodiscard]] uint32_t get_retry_count() const noexcept { return m_retries; }
+
+ protected:
+  uint32_t m_retries{0};
+};
+
+inline void spin_for(uint32_t spin_count) noexcept {
+  for (uint32_t idx = 0; idx < spin_count; ++idx) {
+    YieldProcessor();  // PAUSE on x86 and x64
+  }
+}
+}  // namespace th::details
+
+struct no_backoff : th::details::backoff_base {
+  void pause() noexcept { ++m_retries; }
+};
+
+template <uint32_t MinSpins = 1, uint32_t MaxSpins = 1024>
+class exponential_backoff : public th::details::backoff_base {
+ public:
+  static_assert(MinSpins > 0 && MinSpins <= MaxSpins,
+                "invalid backoff bounds");
+
+ public:
+  void pause() noexcept {
+    ++m_retries;
+    th::details::spin_for(m_spins);
+    if (m_spins < MaxSpins) {
+      m_spins = m_spins * 2 < MaxSpins ? m_spins * 2 : MaxSpins;
+    }
+  }
+
+ private:
+  uint32_t m_spins{MinSpins};
+};
+
+// Picks a random spin count below an exponentially growing bound, so the
+// threads that collided don't retry in lockstep
+template <uint32_t MinSpins = 1, uint32_t MaxSpins = 1024>
+class randomized_backoff : public th::details::backoff_base {
+ public:
+  static_assert(MinSpins > 0 && MinSpins <= MaxSpins,
+                "invalid backoff bounds");
+
+ public:
+  randomized_backoff() noexcept
+      : m_state{static_cast<uint32_t>(__rdtsc()) | 1} {}
+
+  void pause() noexcept {
+    ++m_retries;
+    th::details::spin_for(next_random() % m_bound + 1);
+    if (m_bound < MaxSpins) {
+      m_bound = m_bound * 2 < MaxSpins ? m_bound * 2 : MaxSpins;
+    }
+  }
+
+ private:
+  uint32_t next_random() noexcept {  // xorshift32
+    m_state ^= m_state << 13;
+    m_state ^= m_state >> 17;
+    m_state ^= m_state << 5;
+    return m_state;
+  }
+
+ private:
+  uint32_t m_state;
+  uint32_t m_bound{MinSpins};
+};
+
+// Accumulates the retries of every operation using Backoff into a counter
+// shared by the whole instantiation. Only contended operations touch it,
+// so a single atomic is enough. Tag separates statistics of different users
+template <class Backoff, class Tag = void>
+class counting_backoff : public Backoff {
+ public:
+  using backoff_type = Backoff;
+
+ public:
+  ~counting_backoff() noexcept {
+    if (const auto retries = Backoff::get_retry_count(); retries) {
+      m_total_retries.fetch_add<memory_order_relaxed>(retries);
+    }
+  }
+
+  [[nodiscard]] static uint64_t get_total_retries() noexcept {
+    return m_total_retries.load<memory_order_relaxed>();
+  }
+
+  static void reset_total_retries() noexcept {
+    m_total_retries.store<memory_order_relaxed>(0);
+  }
+
+ private:
+  inline static atomic<uint64_t> m_total_retries{0};
+};
+}  // namespace ktl
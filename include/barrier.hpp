@@ -0,0 +1,80 @@
+#pragma once
+#include <assert.hpp>
+#include <atomic.hpp>
+#include <basic_types.hpp>
+#include <limits.hpp>
+#include <utility.hpp>
+
+namespace ktl {
+namespace th::details {
+struct empty_completion {
+  void operator()() noexcept {}
+};
+}  // namespace th::details
+
+// Reusable phase barrier. The last arriving thread runs the completion
+// function before anyone of the phase is released
+template <class CompletionFunction = th::details::empty_completion>
+class barrier : non_relocatable {
+ public:
+  using phase_type = uint32_t;
+
+  class arrival_token {
+   private:
+    explicit arrival_token(phase_type phase) noexcept : m_phase{phase} {}
+
+   private:
+    friend class barrier;
+
+    phase_type m_phase;
+  };
+
+ public:
+  static constexpr ptrdiff_t(max)() noexcept {
+    return (numeric_limits<ptrdiff_t>::max)();
+  }
+
+ public:
+  explicit barrier(ptrdiff_t expected,
+                   CompletionFunction completion = CompletionFunction())
+      : m_expected{expected},
+        m_remaining{expected},
+        m_completion{move(completion)} {
+    assert_with_msg(expected >= 0, "barrier counter must be non-negative");
+  }
+
+  [[nodiscard]] arrival_token arrive(ptrdiff_t update = 1) {
+    const auto phase{m_phase.load<memory_order_acquire>()};
+    const auto remaining{m_remaining.fetch_sub(update) - update};
+    assert_with_msg(remaining >= 0, "barrier counter underflow");
+    if (!remaining) {
+      // Everyone else of the phase is waiting, so nobody touches the
+      // counter until the phase is advanced
+      m_completion();
+      m_remaining.store(m_expected.load<memory_order_relaxed>());
+      m_phase.store(phase + 1);
+      m_phase.notify_all();
+    }
+    return arrival_token{phase};
+  }
+
+  void wait(arrival_token&& token) const noexcept {
+    while (m_phase.load<memory_order_acquire>() == token.m_phase) {
+      m_phase.wait<memory_order_acquire>(token.m_phase);
+    }
+  }
+
+  void arrive_and_wait() { wait(arrive()); }
+
+  void arrive_and_drop() {
+    --m_expected;  // Takes effect from the next phase
+    [[maybe_unused]] auto token{arrive()};
+  }
+
+ private:
+  atomic<ptrdiff_t> m_expected;
+  atomic<ptrdiff_t> m_remaining;
+  atomic<phase_type> m_phase{0};
+  CompletionFunction m_completion;
+};
+}  // namespace ktl
@@ -0,0 +1,109 @@
+#pragma once
+#include <atomic.hpp>
+#include <basic_types.hpp>
+#include <irql.hpp>
+#include <percpu.hpp>
+#include <thread.hpp>
+
+#include <ntddk.h>
+
+namespace ktl {
+// Big-reader lock: a reader touches only its own processor's counter, a
+// writer sweeps all of them. Both sides can be used at IRQL <= DISPATCH_LEVEL.
+// Both sections run at DISPATCH_LEVEL, so a writer spinning on the counters
+// never waits for a preempted reader and a reader never interrupts the
+// writer; a blocked thread parks at IRQL <= APC_LEVEL and spins above it.
+// Readers aren't recursive
+class brlock : non_relocatable {
+ public:
+  using counter_type = int32_t;
+
+ private:
+  struct reader_slot {
+    atomic<counter_type> readers{0};
+    irql_t prev_irql{};  // Valid only while a read section is held
+  };
+
+ public:
+  brlock() = default;
+
+  void lock_shared() noexcept {
+    for (;;) {
+      const auto prev_irql{raise_irql(DISPATCH_LEVEL)};
+      auto& slot{m_readers.local()};
+      // Full barrier: the flag can't be read before the increment
+      ++slot.readers;
+      if (!m_writer.load<memory_order_relaxed>()) {
+        slot.prev_irql = prev_irql;
+        return;
+      }
+      --slot.readers;
+      lower_irql(prev_irql);
+      m_writer.wait<memory_order_relaxed>(true);
+    }
+  }
+
+  void unlock_shared() noexcept {  // The thread hasn't left the processor
+    auto& slot{m_readers.local()};
+    const auto prev_irql{slot.prev_irql};
+    --slot.readers;
+    lower_irql(prev_irql);
+  }
+
+  // The write section runs at DISPATCH_LEVEL too: otherwise a reader in a DPC
+  // could spin forever on a writer it has interrupted
+  void lock() noexcept {
+    for (;;) {
+      const auto prev_irql{raise_irql(DISPATCH_LEVEL)};
+      bool expected{false};
+      if (m_writer.compare_exchange_strong(expected, true)) {
+        m_writer_prev_irql = prev_irql;
+        break;
+      }
+      lower_irql(prev_irql);
+      m_writer.wait<memory_order_relaxed>(true);
+    }
+    while (has_readers()) {
+      this_thread::yield();
+    }
+    atomic_thread_fence<memory_order_acquire>();
+  }
+
+  bool try_lock() noexcept {
+    const auto prev_irql{raise_irql(DISPATCH_LEVEL)};
+    bool expected{false};
+    if (!m_writer.compare_exchange_strong(expected, true)) {
+      lower_irql(prev_irql);
+      return false;
+    }
+    m_writer_prev_irql = prev_irql;
+    if (has_readers()) {
+      unlock();
+      return false;
+    }
+    atomic_thread_fence<memory_order_acquire>();
+    return true;
+  }
+
+  void unlock() noexcept {
+    const auto prev_irql{m_writer_prev_irql};
+    m_writer.store(false);
+    m_writer.notify_all();
+    lower_irql(prev_irql);
+  }
+
+ private:
+  bool has_readers() const noexcept {
+    counter_type sum{0};
+    m_readers.for_each([&sum](const reader_slot& slot) {
+      sum += slot.readers.load<memory_order_relaxed>();
+    });
+    return sum != 0;
+  }
+
+ private:
+  percpu<reader_slot> m_readers;
+  atomic<bool> m_writer{false};
+  irql_t m_writer_prev_irql{};  // Valid only while the write section is held
+};
+}  // namespace ktl
@@ -2,6 +2,7 @@
 #include <atomic.hpp>
 #include <chrono.hpp>
 #include <mutex.hpp>
+#include <thread.hpp>
 #include <type_traits.hpp>
 #include <utility.hpp>
 
@@ -11,7 +12,7 @@ template <class Lockable, class = void>
 struct has_lock : false_type {};
 
 template <class Lockable>
-struct has_lock<Lockable, void_t<decltype(declval<Lockable>().unlock())>>
+struct has_lock<Lockable, void_t<decltype(declval<Lockable>().lock())>>
     : true_type {};
 
 template <class Lockable, class = void>
@@ -37,7 +38,55 @@ class condition_variable_base : non_relocatable {
   void notify_all() noexcept;
 
  protected:
-  sync_event m_event;
+  struct wait_node : non_relocatable {  // Lives on the waiter's stack
+    wait_node* next{nullptr};
+    sync_event event;
+  };
+
+  // The node is enqueued before the lock is released, so a notification
+  // issued after unlock() can't be missed
+  template <class Lockable, class AwaitHandler>
+  cv_status wait_impl(Lockable& lock, AwaitHandler await_handler) {
+    wait_node node;
+    enqueue(node);
+    lock.unlock();
+    const NTSTATUS status{await_handler(node)};
+    const bool timed_out{status != STATUS_SUCCESS && cancel(node)};
+    lock.lock();
+    return timed_out ? cv_status::timeout : cv_status::no_timeout;
+  }
+
+  template <class Rep, class Period>
+  static NTSTATUS await_for(
+      wait_node& node,
+      const chrono::duration<Rep, Period>& wait_duration) noexcept {
+    return wait_for_impl(wait_duration, [&node](LARGE_INTEGER* interval) {
+      return await(node, interval);
+    });
+  }
+
+  template <class Clock, class Duration>
+  static NTSTATUS await_until(
+      wait_node& node,
+      const chrono::time_point<Clock, Duration>& awake_time) noexcept {
+    return wait_until_impl(awake_time, [&node](LARGE_INTEGER* interval) {
+      return await(node, interval);
+    });
+  }
+
+  static NTSTATUS await(wait_node& node,
+                        const LARGE_INTEGER* timeout) noexcept;
+
+ private:
+  void enqueue(wait_node& node) noexcept;
+  bool cancel(wait_node& node) noexcept;  // false if already notified
+
+  wait_node* pop_front() noexcept;
+
+ private:
+  spin_lock<> m_lock;
+  wait_node* m_head{nullptr};  // FIFO of waiters
+  wait_node* m_tail{nullptr};
   atomic_size_t m_wait_count{0};
 };
 }  // namespace th::details
@@ -46,34 +95,95 @@ struct condition_variable_any : public th::details::condition_variable_base {
   template <class Lockable>
   void wait(Lockable& lock) {
     th::details::basic_lockable_checker<Lockable>{};
-    lock.unlock();
-    ++m_wait_count;
-    m_event.wait();
-    lock.lock();
+    wait_impl(lock, [](wait_node& node) { return await(node, nullptr); });
   }
 
   template <class Lockable, class Predicate>
   void wait(Lockable& lock, Predicate pred) {
-    while (!pred) {
+    while (!pred()) {
       wait(lock);
     }
   }
+
+  template <class Lockable, class Rep, class Period>
+  cv_status wait_for(Lockable& lock,
+                     const chrono::duration<Rep, Period>& wait_duration) {
+    th::details::basic_lockable_checker<Lockable>{};
+    return wait_impl(lock, [&wait_duration](wait_node& node) {
+      return await_for(node, wait_duration);
+    });
+  }
+
+  template <class Lockable, class Rep, class Period, class Predicate>
+  bool wait_for(Lockable& lock,
+                const chrono::duration<Rep, Period>& wait_duration,
+                Predicate pred) {
+    return wait_until(lock, chrono::steady_clock::now() + wait_duration,
+                      move(pred));
+  }
+
+  template <class Lockable, class Clock, class Duration>
+  cv_status wait_until(Lockable& lock,
+                       const chrono::time_point<Clock, Duration>& awake_time) {
+    th::details::basic_lockable_checker<Lockable>{};
+    return wait_impl(lock, [&awake_time](wait_node& node) {
+      return await_until(node, awake_time);
+    });
+  }
+
+  template <class Lockable, class Clock, class Duration, class Predicate>
+  bool wait_until(Lockable& lock,
+                  const chrono::time_point<Clock, Duration>& awake_time,
+                  Predicate pred) {
+    while (!pred()) {
+      if (wait_until(lock, awake_time) == cv_status::timeout) {
+        return pred();
+      }
+    }
+    return true;
+  }
 };
 
-struct condition_variable : public th::details::condition_variable_base {
+struct condition_variable : private condition_variable_any {
+  using MyBase = condition_variable_any;
+
+  using MyBase::notify_all;
+  using MyBase::notify_one;
+
   template <class Mutex>
   void wait(unique_lock<Mutex>& lock) {
-    lock.unlock();
-    ++m_wait_count;
-    m_event.wait();
-    lock.lock();
+    MyBase::wait(lock);
   }
 
   template <class Mutex, class Predicate>
   void wait(unique_lock<Mutex>& lock, Predicate pred) {
-    while (!pred) {
-      wait(lock);
-    }
+    MyBase::wait(lock, move(pred));
+  }
+
+  template <class Mutex, class Rep, class Period>
+  cv_status wait_for(unique_lock<Mutex>& lock,
+                     const chrono::duration<Rep, Period>& wait_duration) {
+    return MyBase::wait_for(lock, wait_duration);
+  }
+
+  template <class Mutex, class Rep, class Period, class Predicate>
+  bool wait_for(unique_lock<Mutex>& lock,
+                const chrono::duration<Rep, Period>& wait_duration,
+                Predicate pred) {
+    return MyBase::wait_for(lock, wait_duration, move(pred));
+  }
+
+  template <class Mutex, class Clock, class Duration>
+  cv_status wait_until(unique_lock<Mutex>& lock,
+                       const chrono::time_point<Clock, Duration>& awake_time) {
+    return MyBase::wait_until(lock, awake_time);
+  }
+
+  template <class Mutex, class Clock, class Duration, class Predicate>
+  bool wait_until(unique_lock<Mutex>& lock,
+                  const chrono::time_point<Clock, Duration>& awake_time,
+                  Predicate pred) {
+    return MyBase::wait_until(lock, awake_time, move(pred));
   }
 };
-}  // namespace ktl
\ No newline at end of file
+}  // namespace ktl
@@ -0,0 +1,255 @@
+#pragma once
+#include <assert.hpp>
+#include <basic_types.hpp>
+#include <functional.hpp>
+#include <new_delete.hpp>
+#include <type_traits.hpp>
+#include <utility.hpp>
+
+namespace ktl {
+namespace func::details {
+template <class Ret, class Fn, class... Types>
+Ret invoke_r(Fn& fn, Types&&... args) {
+  if constexpr (is_void_v<Ret>) {
+    invoke(fn, forward<Types>(args)...);
+  } else {
+    return invoke(fn, forward<Types>(args)...);
+  }
+}
+
+// Hand-made vtable shared by all the wrappers of the same callable type
+template <bool Noexcept, class Ret, class... Types>
+struct callable_ops {
+  using call_t = Ret (*)(void* storage, Types&&... args) noexcept(Noexcept);
+  using relocate_t = void (*)(void* from, void* to) noexcept;
+  using destroy_t = void (*)(void* storage) noexcept;
+
+  call_t call;
+  relocate_t relocate;  // Moves the callable to 'to' and destroys 'from'
+  destroy_t destroy;
+};
+
+template <class Fn, bool Noexcept, class Ret, class... Types>
+struct inline_ops {
+  static Ret call(void* storage, Types&&... args) noexcept(Noexcept) {
+    return invoke_r<Ret>(*static_cast<Fn*>(storage), forward<Types>(args)...);
+  }
+
+  static void relocate(void* from, void* to) noexcept {
+    auto& source{*static_cast<Fn*>(from)};
+    ::new (to) Fn(move(source));
+    source.~Fn();
+  }
+
+  static void destroy(void* storage) noexcept {
+    static_cast<Fn*>(storage)->~Fn();
+  }
+
+  static constexpr callable_ops<Noexcept, Ret, Types...> table{
+      &call, &relocate, &destroy};
+};
+
+template <class Fn, bool Noexcept, class Ret, class... Types>
+struct heap_ops {
+  static Fn*& get_ptr(void* storage) noexcept {
+    return *static_cast<Fn**>(storage);
+  }
+
+  static Ret call(void* storage, Types&&... args) noexcept(Noexcept) {
+    return invoke_r<Ret>(*get_ptr(storage), forward<Types>(args)...);
+  }
+
+  static void relocate(void* from, void* to) noexcept {
+    ::new (to) Fn*(get_ptr(from));
+  }
+
+  static void destroy(void* storage) noexcept { delete get_ptr(storage); }
+
+  static constexpr callable_ops<Noexcept, Ret, Types...> table{
+      &call, &relocate, &destroy};
+};
+
+template <class Signature>
+struct signature_traits;
+
+template <class Ret, class... Types>
+struct signature_traits<Ret(Types...)> {
+  template <class Fn>
+  static constexpr bool is_compatible = is_invocable_r_v<Ret, Fn&, Types...>;
+
+  using ops_type = callable_ops<false, Ret, Types...>;
+
+  template <class Fn>
+  using inline_ops_type = inline_ops<Fn, false, Ret, Types...>;
+
+  template <class Fn>
+  using heap_ops_type = heap_ops<Fn, false, Ret, Types...>;
+};
+
+template <class Ret, class... Types>
+struct signature_traits<Ret(Types...) noexcept> {
+  template <class Fn>
+  static constexpr bool is_compatible =
+      is_invocable_r_v<Ret, Fn&, Types...> &&
+      is_nothrow_invocable_v<Fn&, Types...>;
+
+  using ops_type = callable_ops<true, Ret, Types...>;
+
+  template <class Fn>
+  using inline_ops_type = inline_ops<Fn, true, Ret, Types...>;
+
+  template <class Fn>
+  using heap_ops_type = heap_ops<Fn, true, Ret, Types...>;
+};
+
+template <class Derived, class Signature>
+class call_operator;
+
+template <class Derived, class Ret, class... Types>
+class call_operator<Derived, Ret(Types...)> {
+ public:
+  Ret operator()(Types... args) {
+    auto& self{static_cast<Derived&>(*this)};
+    return self.get_ops().call(self.get_storage(), forward<Types>(args)...);
+  }
+};
+
+template <class Derived, class Ret, class... Types>
+class call_operator<Derived, Ret(Types...) noexcept> {
+ public:
+  Ret operator()(Types... args) noexcept {
+    auto& self{static_cast<Derived&>(*this)};
+    return self.get_ops().call(self.get_storage(), forward<Types>(args)...);
+  }
+};
+
+// Callables which fit into the buffer and can be moved without exceptions
+// are stored inline; the others are allocated from the non-paged pool if
+// AllowHeap is true and rejected at compile time otherwise
+template <class Signature, size_t Capacity, size_t Align, bool AllowHeap>
+class basic_function
+    : public call_operator<
+          basic_function<Signature, Capacity, Align, AllowHeap>,
+          Signature> {
+ private:
+  using traits = signature_traits<Signature>;
+  using ops_type = typename traits::ops_type;
+
+  friend class call_operator<basic_function, Signature>;
+
+  template <class Fn>
+  static constexpr bool fits_inline = sizeof(Fn) <= Capacity &&
+                                      alignof(Fn) <= Align &&
+                                      is_nothrow_move_constructible_v<Fn>;
+
+  static_assert(!AllowHeap || Capacity >= sizeof(void*),
+                "buffer must be able to hold a pointer");
+
+ public:
+  basic_function() noexcept = default;
+  basic_function(nullptr_t) noexcept {}
+
+  template <class Fn,
+            enable_if_t<!is_same_v<decay_t<Fn>, basic_function> &&
+                            traits::template is_compatible<decay_t<Fn> >,
+                        int> = 0>
+  basic_function(Fn&& fn) {
+    emplace<decay_t<Fn> >(forward<Fn>(fn));
+  }
+
+  basic_function(basic_function&& other) noexcept { steal(other); }
+
+  basic_function& operator=(basic_function&& other) noexcept {
+    if (this != addressof(other)) {
+      reset();
+      steal(other);
+    }
+    return *this;
+  }
+
+  basic_function& operator=(nullptr_t) noexcept {
+    reset();
+    return *this;
+  }
+
+  template <class Fn,
+            enable_if_t<!is_same_v<decay_t<Fn>, basic_function> &&
+                            traits::template is_compatible<decay_t<Fn> >,
+                        int> = 0>
+  basic_function& operator=(Fn&& fn) {
+    basic_function{forward<Fn>(fn)}.swap(*this);
+    return *this;
+  }
+
+  basic_function(const basic_function&) = delete;
+  basic_function& operator=(const basic_function&) = delete;
+
+  ~basic_function() noexcept { reset(); }
+
+  explicit operator bool() const noexcept { return m_ops != nullptr; }
+
+  void swap(basic_function& other) noexcept {
+    basic_function tmp{move(other)};
+    other = move(*this);
+    *this = move(tmp);
+  }
+
+ private:
+  template <class Fn, class... Types>
+  void emplace(Types&&... args) {
+    if constexpr (fits_inline<Fn>) {
+      ::new (get_storage()) Fn(forward<Types>(args)...);
+      m_ops = addressof(traits::template inline_ops_type<Fn>::table);
+    } else {
+      static_assert(AllowHeap,
+                    "callable doesn't fit into inplace_function or its move "
+                    "constructor may throw");
+      ::new (get_storage()) Fn*(new (non_paged_new)
+                                    Fn(forward<Types>(args)...));
+      m_ops = addressof(traits::template heap_ops_type<Fn>::table);
+    }
+  }
+
+  void steal(basic_function& other) noexcept {
+    if (other.m_ops) {
+      other.m_ops->relocate(other.get_storage(), get_storage());
+      m_ops = exchange(other.m_ops, nullptr);
+    }
+  }
+
+  void reset() noexcept {
+    if (m_ops) {
+      exchange(m_ops, nullptr)->destroy(get_storage());
+    }
+  }
+
+  const ops_type& get_ops() const noexcept {
+    assert_with_msg(m_ops, "calling an empty function");
+    return *m_ops;
+  }
+
+  void* get_storage() noexcept { return addressof(m_storage); }
+
+ private:
+  aligned_storage_t<Capacity, Align> m_storage;
+  const ops_type* m_ops{nullptr};
+};
+}  // namespace func::details
+
+// Never allocates: a callable which doesn't fit is a compile-time error.
+// Signature may be noexcept-qualified, e.g. void(int) noexcept
+template <class Signature,
+          size_t Capacity = 4 * sizeof(void*),
+          size_t Align = alignof(max_align_t)>
+using inplace_function =
+    func::details::basic_function<Signature, Capacity, Align, false>;
+
+// Stores small callables inline and the others in the non-paged pool, so it
+// can be created and destroyed at IRQL <= DISPATCH_LEVEL
+template <class Signature>
+using move_only_function =
+    func::details::basic_function<Signature,
+                                  3 * sizeof(void*),
+                                  alignof(max_align_t),
+                                  true>;
+}  // namespace ktl
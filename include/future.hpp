@@ -0,0 +1,433 @@
+#pragma once
+#include <assert.hpp>
+#include <atomic.hpp>
+#include <basic_types.hpp>
+#include <chrono.hpp>
+#include <functional.hpp>
+#include <ktlexcept.hpp>
+#include <memory_impl.hpp>
+#include <new_delete.hpp>
+#include <thread.hpp>
+#include <thread_pool.hpp>
+#include <tuple.hpp>
+#include <type_traits.hpp>
+#include <utility.hpp>
+
+#include <ntddk.h>
+
+namespace ktl {
+enum class future_status { ready, timeout };
+
+namespace th::details {
+// Reference counted state shared by a promise or an asynchronous call and
+// its futures. Instead of an exception the producer stores NTSTATUS, which
+// get() rethrows as kernel_error
+class future_state_base : non_relocatable {
+ public:
+  void acquire() noexcept { ++m_refs; }
+
+  void release() noexcept {
+    if (--m_refs == 0) {
+      destroy();
+    }
+  }
+
+  [[nodiscard]] bool is_ready() const noexcept {
+    return m_ready.load<memory_order_acquire>() != 0;
+  }
+
+  void wait() const noexcept {  // IRQL <= APC_LEVEL
+    while (!is_ready()) {
+      m_ready.wait<memory_order_acquire>(0);
+    }
+  }
+
+  template <class Rep, class Period>
+  future_status wait_for(
+      const chrono::duration<Rep, Period>& wait_duration) const noexcept {
+    return wait_until(chrono::steady_clock::now() + wait_duration);
+  }
+
+  template <class Clock, class Duration>
+  future_status wait_until(
+      const chrono::time_point<Clock, Duration>& awake_time) const noexcept {
+    while (!is_ready()) {
+      if (!m_ready.wait_until<memory_order_acquire>(0, awake_time)) {
+        return is_ready() ? future_status::ready : future_status::timeout;
+      }
+    }
+    return future_status::ready;
+  }
+
+  void set_error(NTSTATUS status) noexcept {
+    assert_with_msg(!NT_SUCCESS(status), "error status expected");
+    make_ready(status);
+  }
+
+ protected:
+  future_state_base() noexcept = default;
+  virtual ~future_state_base() noexcept = default;
+
+  virtual void destroy() noexcept { delete this; }
+
+  void make_ready(NTSTATUS status) noexcept {
+    assert_with_msg(!is_ready(), "promise already satisfied");
+    m_status = status;
+    m_ready.store<memory_order_release>(1);
+    m_ready.notify_all();
+  }
+
+  [[nodiscard]] bool has_value() const noexcept {
+    return is_ready() && NT_SUCCESS(m_status);
+  }
+
+  void wait_and_verify() const {
+    wait();
+    throw_exception_if_not<kernel_error>(NT_SUCCESS(m_status), m_status,
+                                         "asynchronous operation failed");
+  }
+
+ private:
+  atomic<uint32_t> m_refs{1};
+  atomic<uint32_t> m_ready{0};
+  NTSTATUS m_status{STATUS_PENDING};
+};
+
+template <class Ty>
+class future_state : public future_state_base {
+ public:
+  static_assert(!is_reference_v<Ty>,
+                "future<Ty&> isn't supported, use future<Ty*> instead");
+
+ public:
+  template <class... Types>
+  void set_value(Types&&... args) {
+    assert_with_msg(!is_ready(), "promise already satisfied");
+    construct_at(get_ptr(), forward<Types>(args)...);
+    make_ready(STATUS_SUCCESS);
+  }
+
+  Ty& get_value() {
+    wait_and_verify();
+    return *get_ptr();
+  }
+
+ protected:
+  ~future_state() noexcept override {
+    if (has_value()) {
+      get_ptr()->~Ty();
+    }
+  }
+
+ private:
+  Ty* get_ptr() noexcept { return reinterpret_cast<Ty*>(addressof(m_storage)); }
+
+ private:
+  aligned_storage_t<sizeof(Ty), alignof(Ty)> m_storage;
+};
+
+template <>
+class future_state<void> : public future_state_base {
+ public:
+  void set_value() noexcept { make_ready(STATUS_SUCCESS); }
+  void get_value() const { wait_and_verify(); }
+};
+
+// The callable and its decay-copied arguments live in the shared state,
+// followed by the I/O work item when the call goes to a system worker
+template <class Ty, class ArgTuple>
+class async_state final : public future_state<Ty> {
+ public:
+  template <class... Types>
+  static async_state* create(size_t extra_size, Types&&... args) {
+    auto* place{::operator new(sizeof(async_state) + extra_size,
+                               non_paged_new)};
+    try {
+      return ::new (place) async_state(forward<Types>(args)...);
+    } catch (...) {
+      ::operator delete(place, non_paged_new);
+      throw;
+    }
+  }
+
+  void run() noexcept {
+    try {
+      if constexpr (is_void_v<Ty>) {
+        apply(invoker{}, move(m_args));
+        this->set_value();
+      } else {
+        this->set_value(apply(invoker{}, move(m_args)));
+      }
+    } catch (const exception& exc) {
+      this->set_error(exc.code());
+    } catch (...) {
+      this->set_error(STATUS_UNHANDLED_EXCEPTION);
+    }
+  }
+
+  void* get_extra_storage() noexcept { return this + 1; }
+
+  static void run_in_work_item(void* raw_state) noexcept {
+    static_cast<async_state*>(raw_state)->run();
+  }
+
+  static void release_state(void* raw_state) noexcept {
+    static_cast<async_state*>(raw_state)->release();
+  }
+
+ private:
+  struct invoker {
+    template <class Fn, class... Types>
+    decltype(auto) operator()(Fn&& fn, Types&&... args) const {
+      return invoke(forward<Fn>(fn), forward<Types>(args)...);
+    }
+  };
+
+  template <class... Types>
+  explicit async_state(Types&&... args) : m_args{forward<Types>(args)...} {}
+
+  void destroy() noexcept override {
+    this->~async_state();
+    ::operator delete(static_cast<void*>(this), non_paged_new);
+  }
+
+ private:
+  ArgTuple m_args;
+};
+
+using work_routine_t = void (*)(void* context) noexcept;
+
+// IO_WORKITEM keeps the driver loaded until the work routine returns.
+// run is called at PASSIVE_LEVEL in a system worker thread, then
+// the work item is uninitialized and finish is called
+size_t get_work_item_size() noexcept;
+void queue_work_item(void* work_item,
+                     work_routine_t run,
+                     work_routine_t finish,
+                     void* context) noexcept;
+
+template <class Ty>
+class future_holder {
+ public:
+  constexpr future_holder() noexcept = default;
+
+  explicit future_holder(future_state<Ty>* state) noexcept : m_state{state} {}
+
+  future_holder(const future_holder& other) noexcept
+      : m_state{other.m_state} {
+    if (m_state) {
+      m_state->acquire();
+    }
+  }
+
+  future_holder(future_holder&& other) noexcept
+      : m_state{exchange(other.m_state, nullptr)} {}
+
+  future_holder& operator=(const future_holder& other) noexcept {
+    if (this != addressof(other)) {
+      future_holder{other}.swap(*this);
+    }
+    return *this;
+  }
+
+  future_holder& operator=(future_holder&& other) noexcept {
+    if (this != addressof(other)) {
+      future_holder{move(other)}.swap(*this);
+    }
+    return *this;
+  }
+
+  ~future_holder() noexcept {
+    if (m_state) {
+      m_state->release();
+    }
+  }
+
+  [[nodiscard]] bool valid() const noexcept { return m_state != nullptr; }
+
+  void wait() const { get_state().wait(); }
+
+  template <class Rep, class Period>
+  future_status wait_for(
+      const chrono::duration<Rep, Period>& wait_duration) const {
+    return get_state().wait_for(wait_duration);
+  }
+
+  template <class Clock, class Duration>
+  future_status wait_until(
+      const chrono::time_point<Clock, Duration>& awake_time) const {
+    return get_state().wait_until(awake_time);
+  }
+
+  void swap(future_holder& other) noexcept {
+    ktl::swap(m_state, other.m_state);
+  }
+
+ protected:
+  future_state<Ty>& get_state() const {
+    throw_exception_if_not<future_error>(m_state);
+    return *m_state;
+  }
+
+  future_state<Ty>* m_state{nullptr};
+};
+}  // namespace th::details
+
+template <class Ty>
+class shared_future;
+
+// Futures may be waited on at IRQL <= APC_LEVEL only
+template <class Ty>
+class future : public th::details::future_holder<Ty> {
+ public:
+  using MyBase = th::details::future_holder<Ty>;
+
+ public:
+  constexpr future() noexcept = default;
+  explicit future(th::details::future_state<Ty>* state) noexcept
+      : MyBase(state) {}
+
+  future(future&&) noexcept = default;
+  future& operator=(future&&) noexcept = default;
+
+  Ty get() {  // Invalidates the future
+    future released{move(*this)};
+    if constexpr (is_void_v<Ty>) {
+      released.get_state().get_value();
+    } else {
+      return move(released.get_state().get_value());
+    }
+  }
+
+  shared_future<Ty> share() noexcept;
+};
+
+template <class Ty>
+class shared_future : public th::details::future_holder<Ty> {
+ public:
+  using MyBase = th::details::future_holder<Ty>;
+
+ public:
+  constexpr shared_future() noexcept = default;
+  shared_future(future<Ty>&& other) noexcept : MyBase(move(other)) {}
+
+  decltype(auto) get() const {
+    if constexpr (is_void_v<Ty>) {
+      this->get_state().get_value();
+    } else {
+      return static_cast<const Ty&>(this->get_state().get_value());
+    }
+  }
+};
+
+template <class Ty>
+shared_future<Ty> future<Ty>::share() noexcept {
+  return shared_future<Ty>{move(*this)};
+}
+
+// set_value() and set_error() may be called at IRQL <= DISPATCH_LEVEL.
+// A promise destroyed unsatisfied completes with STATUS_CANCELLED
+template <class Ty>
+class promise {
+ private:
+  using state_type = th::details::future_state<Ty>;
+
+ public:
+  promise() : m_state{new (non_paged_new) state_type} {}
+
+  promise(promise&& other) noexcept
+      : m_state{exchange(other.m_state, nullptr)},
+        m_future_retrieved{other.m_future_retrieved} {}
+
+  promise& operator=(promise&& other) noexcept {
+    if (this != addressof(other)) {
+      promise{move(other)}.swap(*this);
+    }
+    return *this;
+  }
+
+  promise(const promise&) = delete;
+  promise& operator=(const promise&) = delete;
+
+  ~promise() noexcept {
+    if (m_state) {
+      if (!m_state->is_ready()) {
+        m_state->set_error(STATUS_CANCELLED);
+      }
+      m_state->release();
+    }
+  }
+
+  [[nodiscard]] future<Ty> get_future() {
+    throw_exception_if_not<future_error>(m_state && !m_future_retrieved);
+    m_future_retrieved = true;
+    m_state->acquire();
+    return future<Ty>{m_state};
+  }
+
+  template <class... Types>
+  void set_value(Types&&... args) {
+    throw_exception_if_not<future_error>(m_state);
+    m_state->set_value(forward<Types>(args)...);
+  }
+
+  void set_error(NTSTATUS status) {
+    throw_exception_if_not<future_error>(m_state);
+    m_state->set_error(status);
+  }
+
+  void swap(promise& other) noexcept {
+    ktl::swap(m_state, other.m_state);
+    ktl::swap(m_future_retrieved, other.m_future_retrieved);
+  }
+
+ private:
+  state_type* m_state;
+  bool m_future_retrieved{false};
+};
+
+template <class Fn, class... Types>
+using async_result_t = invoke_result_t<decay_t<Fn>, decay_t<Types>...>;
+
+// Runs fn(args...) at PASSIVE_LEVEL in a system worker thread. May be called
+// at IRQL <= DISPATCH_LEVEL; the arguments are decay-copied into the state.
+// Exceptions thrown by fn are reported by get() as kernel_error
+template <class Fn, class... Types>
+[[nodiscard]] future<async_result_t<Fn, Types...> > async(Fn&& fn,
+                                                         Types&&... args) {
+  using state_type =
+      th::details::async_state<async_result_t<Fn, Types...>,
+                               tuple<decay_t<Fn>, decay_t<Types>...> >;
+  auto* state{state_type::create(th::details::get_work_item_size(),
+                                 forward<Fn>(fn), forward<Types>(args)...)};
+  state->acquire();  // Released by the work item
+  th::details::queue_work_item(state->get_extra_storage(),
+                               &state_type::run_in_work_item,
+                               &state_type::release_state, state);
+  return future<async_result_t<Fn, Types...> >{state};
+}
+
+// Same as above, but fn(args...) runs in the pool
+template <class Fn, class... Types>
+[[nodiscard]] future<async_result_t<Fn, Types...> > async(thread_pool& pool,
+                                                         Fn&& fn,
+                                                         Types&&... args) {
+  using state_type =
+      th::details::async_state<async_result_t<Fn, Types...>,
+                               tuple<decay_t<Fn>, decay_t<Types>...> >;
+  auto* state{
+      state_type::create(0, forward<Fn>(fn), forward<Types>(args)...)};
+  future<async_result_t<Fn, Types...> > result{state};
+  state->acquire();  // Released by the task
+  try {
+    pool.submit([state]() noexcept {
+      state->run();
+      state->release();
+    });
+  } catch (...) {
+    state->release();
+    throw;
+  }
+  return result;
+}
+}  // namespace ktl
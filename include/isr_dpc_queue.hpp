@@ -0,0 +1,97 @@
+#pragma once
+#include <atomic.hpp>
+#include <basic_types.hpp>
+#include <heap.hpp>
+#include <limits.hpp>
+#include <mutex.hpp>
+#include <type_traits.hpp>
+#include <utility.hpp>
+
+#include <ntddk.h>
+
+namespace ktl {
+// Single-producer ring filled by an ISR and drained by a DPC in batches.
+// The ISR of one KINTERRUPT is serialized by its interrupt spin lock, so
+// push() needs neither locks nor atomic RMW. The same KDPC may run on two
+// processors at once, hence the consumers are serialized by try_lock().
+// The owner must disconnect the interrupt and call KeFlushQueuedDpcs()
+// before destruction
+template <class Ty, size_t Capacity, class Handler>
+class isr_dpc_queue : non_relocatable {
+ public:
+  using value_type = Ty;
+  using handler_type = Handler;
+  using index_type = uint32_t;
+
+  static_assert(is_trivially_copyable_v<Ty>,
+                "isr_dpc_queue<Ty> requires Ty to be trivially copyable");
+  static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0,
+                "Capacity must be a power of 2");
+  static_assert(Capacity <= (numeric_limits<index_type>::max)() / 2,
+                "Capacity is too big");
+
+ public:
+  explicit isr_dpc_queue(Handler handler = Handler()) noexcept(
+      is_nothrow_move_constructible_v<Handler>)
+      : m_handler{move(handler)} {
+    KeInitializeDpc(addressof(m_dpc), &dpc_routine, this);
+  }
+
+  ~isr_dpc_queue() noexcept { KeRemoveQueueDpc(addressof(m_dpc)); }
+
+  // Called from the ISR. Returns false if the ring is full
+  bool push(const Ty& value) noexcept {
+    const auto tail{m_tail.load<memory_order_relaxed>()};
+    if (tail - m_head.load<memory_order_acquire>() == Capacity) {
+      m_overflow_count.store<memory_order_relaxed>(
+          m_overflow_count.load<memory_order_relaxed>() + 1);
+      return false;
+    }
+    m_buffer[tail & (Capacity - 1)] = value;
+    m_tail.store<memory_order_release>(tail + 1);
+    KeInsertQueueDpc(addressof(m_dpc), nullptr, nullptr);
+    return true;
+  }
+
+  [[nodiscard]] bool empty() const noexcept {
+    return m_head.load<memory_order_relaxed>() ==
+           m_tail.load<memory_order_acquire>();
+  }
+
+  [[nodiscard]] size_t get_overflow_count() const noexcept {
+    return m_overflow_count.load<memory_order_relaxed>();
+  }
+
+ private:
+  static void NTAPI dpc_routine(KDPC*,
+                                void* context,
+                                void*,
+                                void*) noexcept {
+    static_cast<isr_dpc_queue*>(context)->drain();
+  }
+
+  void drain() noexcept {
+    do {
+      if (!m_consumer_lock.try_lock()) {
+        return;  // The other instance will re-check the ring on exit
+      }
+      const auto head{m_head.load<memory_order_relaxed>()};
+      const auto tail{m_tail.load<memory_order_acquire>()};
+      for (auto idx = head; idx != tail; ++idx) {
+        m_handler(m_buffer[idx & (Capacity - 1)]);
+      }
+      m_head.store<memory_order_release>(tail);  // Frees the whole batch
+      m_consumer_lock.unlock();
+    } while (!empty());
+  }
+
+ private:
+  alignas(crt::CACHE_LINE_SIZE) atomic<index_type> m_tail{0};  // ISR
+  atomic_size_t m_overflow_count{0};
+  alignas(crt::CACHE_LINE_SIZE) atomic<index_type> m_head{0};  // DPC
+  spin_lock<DISPATCH_LEVEL, DISPATCH_LEVEL> m_consumer_lock;
+  Handler m_handler;
+  KDPC m_dpc;
+  Ty m_buffer[Capacity];
+};
+}  // namespace ktl
@@ -0,0 +1,51 @@
+#pragma once
+#include <assert.hpp>
+#include <atomic.hpp>
+#include <basic_types.hpp>
+#include <limits.hpp>
+
+namespace ktl {
+// Single-use downward counter. Waiting spins briefly and then parks at
+// IRQL <= APC_LEVEL; count_down() can be called at IRQL <= DISPATCH_LEVEL
+class latch : non_relocatable {
+ public:
+  static constexpr ptrdiff_t(max)() noexcept {
+    return (numeric_limits<ptrdiff_t>::max)();
+  }
+
+ public:
+  explicit latch(ptrdiff_t expected) noexcept : m_counter{expected} {
+    assert_with_msg(expected >= 0, "latch counter must be non-negative");
+  }
+
+  void count_down(ptrdiff_t update = 1) noexcept {
+    const auto remaining{m_counter.fetch_sub(update) - update};
+    assert_with_msg(remaining >= 0, "latch counter underflow");
+    if (!remaining) {
+      m_counter.notify_all();
+    }
+  }
+
+  [[nodiscard]] bool try_wait() const noexcept {
+    return m_counter.load<memory_order_acquire>() == 0;
+  }
+
+  void wait() const noexcept {
+    for (;;) {
+      const auto current{m_counter.load<memory_order_acquire>()};
+      if (!current) {
+        return;
+      }
+      m_counter.wait<memory_order_acquire>(current);
+    }
+  }
+
+  void arrive_and_wait(ptrdiff_t update = 1) noexcept {
+    count_down(update);
+    wait();
+  }
+
+ private:
+  atomic<ptrdiff_t> m_counter;
+};
+}  // namespace ktl
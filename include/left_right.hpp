@@ -0,0 +1,124 @@
+#pragma once
+#include <atomic.hpp>
+#include <basic_types.hpp>
+#include <functional.hpp>
+#include <mutex.hpp>
+#include <percpu.hpp>
+#include <thread.hpp>
+#include <type_traits.hpp>
+#include <utility.hpp>
+
+#include <ntddk.h>
+
+namespace ktl {
+namespace th::details {
+// Per-processor ingress/egress counters. A reader may depart on another
+// processor than it arrived on, so only the sums are meaningful
+class reader_indicator : non_relocatable {
+ public:
+  using counter_type = uint32_t;
+
+ private:
+  struct counters {
+    atomic<counter_type> ingress{0};
+    atomic<counter_type> egress{0};
+  };
+
+ public:
+  void arrive() noexcept { ++m_counters.local().ingress; }
+  void depart() noexcept { ++m_counters.local().egress; }
+
+  [[nodiscard]] bool is_empty() const noexcept {
+    // Egress must be collected first: a reader departing during the sweep
+    // can only make the egress sum smaller than the ingress one
+    counter_type egress_sum{0};
+    m_counters.for_each([&egress_sum](const counters& slot) {
+      egress_sum += slot.egress.load<memory_order_acquire>();
+    });
+    counter_type ingress_sum{0};
+    m_counters.for_each([&ingress_sum](const counters& slot) {
+      ingress_sum += slot.ingress.load<memory_order_acquire>();
+    });
+    return egress_sum == ingress_sum;
+  }
+
+ private:
+  percpu<counters> m_counters;
+};
+}  // namespace th::details
+
+// Left-right concurrency control: two copies of Container, readers never block
+// or retry and writers apply each operation to both copies in turn. Operations
+// passed to write() must be deterministic
+template <class Container, class Mutex = fast_mutex>
+class left_right : non_relocatable {
+ public:
+  using container_type = Container;
+  using mutex_type = Mutex;
+
+ private:
+  using index_type = uint32_t;
+
+  class read_guard : non_relocatable {
+   public:
+    explicit read_guard(th::details::reader_indicator& indicator) noexcept
+        : m_indicator{indicator} {
+      m_indicator.arrive();
+    }
+
+    ~read_guard() noexcept { m_indicator.depart(); }
+
+   private:
+    th::details::reader_indicator& m_indicator;
+  };
+
+ public:
+  template <class U = Container,
+            enable_if_t<is_default_constructible_v<U>, int> = 0>
+  left_right() {}  // Reader indicators allocate per-CPU slots
+
+  explicit left_right(const Container& initial)
+      : m_instances{initial, initial} {}
+
+  template <class Fn>
+  auto read(Fn&& fn) const {
+    read_guard guard{m_indicators[m_version.load<memory_order_acquire>()]};
+    return invoke(forward<Fn>(fn),
+                  m_instances[m_left_right.load<memory_order_acquire>()]);
+  }
+
+  template <class Operation>
+  void write(Operation op) {
+    lock_guard guard{m_mtx};
+    const auto current{m_left_right.load<memory_order_relaxed>()};
+    invoke(op, m_instances[current ^ 1]);
+    m_left_right.store(current ^ 1);  // New readers go to the updated copy
+    toggle_version_and_wait();
+    invoke(op, m_instances[current]);
+  }
+
+ private:
+  void toggle_version_and_wait() noexcept {
+    const auto prev_version{m_version.load<memory_order_relaxed>()};
+    const auto next_version{prev_version ^ 1};
+
+    wait_for_readers(m_indicators[next_version]);
+    m_version.store(next_version);
+    wait_for_readers(m_indicators[prev_version]);
+  }
+
+  static void wait_for_readers(
+      const th::details::reader_indicator& indicator) noexcept {
+    while (!indicator.is_empty()) {
+      this_thread::yield();
+    }
+  }
+
+ private:
+  Container m_instances[2]{};
+  atomic<index_type> m_left_right{0};
+  atomic<index_type> m_version{0};
+  mutable th::details::reader_indicator m_indicators[2];
+  mutex_type m_mtx;
+};
+}  // namespace ktl
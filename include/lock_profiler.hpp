@@ -0,0 +1,198 @@
+#pragma once
+#include <atomic.hpp>
+#include <basic_types.hpp>
+#include <mutex.hpp>
+#include <thread_safe_statics.hpp>
+#include <type_traits.hpp>
+#include <utility.hpp>
+
+#include <ntddk.h>
+
+// Lock profiling is opt-in: unless KTL_ENABLE_LOCK_PROFILING is defined,
+// profiled<Mutex> is the bare Mutex and the lock site name is discarded
+
+namespace ktl {
+struct lock_statistics {  // Times are in performance counter ticks
+  using counter_type = uint64_t;
+
+  const char* name;
+  counter_type acquisitions;
+  counter_type contentions;
+  counter_type total_wait_time;
+  counter_type max_wait_time;
+  counter_type total_hold_time;  // Exclusive ownership only
+  counter_type max_hold_time;
+};
+
+class lock_profile_registry;
+
+namespace th::details {
+class lock_profile : non_relocatable {
+ public:
+  using counter_type = lock_statistics::counter_type;
+
+ public:
+  explicit lock_profile(const char* name) noexcept;
+  ~lock_profile() noexcept;
+
+  void on_acquired(counter_type wait_time, bool contended) noexcept;
+  void on_released(counter_type hold_time) noexcept;
+
+  [[nodiscard]] lock_statistics get_statistics() const noexcept;
+
+  static counter_type now() noexcept {
+    return static_cast<counter_type>(
+        KeQueryPerformanceCounter(nullptr).QuadPart);
+  }
+
+ private:
+  static void update_max(atomic<counter_type>& target,
+                         counter_type value) noexcept;
+
+ private:
+  friend class ktl::lock_profile_registry;
+
+  const char* m_name;
+  atomic<counter_type> m_acquisitions{0};
+  atomic<counter_type> m_contentions{0};
+  atomic<counter_type> m_total_wait_time{0};
+  atomic<counter_type> m_max_wait_time{0};
+  atomic<counter_type> m_total_hold_time{0};
+  atomic<counter_type> m_max_hold_time{0};
+  lock_profile* m_prev{nullptr};
+  lock_profile* m_next{nullptr};
+};
+
+template <class Mutex, class = void>
+struct has_try_lock : false_type {};
+
+template <class Mutex>
+struct has_try_lock<Mutex, void_t<decltype(declval<Mutex&>().try_lock())>>
+    : true_type {};
+
+template <class Mutex>
+inline constexpr bool has_try_lock_v = has_try_lock<Mutex>::value;
+}  // namespace th::details
+
+class lock_profile_registry : non_relocatable {
+ public:
+  static lock_profile_registry& get_instance() noexcept;
+
+  void add(th::details::lock_profile& profile) noexcept;
+  void remove(th::details::lock_profile& profile) noexcept;
+
+  template <class Fn>
+  void for_each(Fn fn) {  // fn is called at DISPATCH_LEVEL
+    lock_guard guard{m_lock};
+    for (auto* profile = m_head; profile; profile = profile->m_next) {
+      fn(profile->get_statistics());
+    }
+  }
+
+  void dump() noexcept;  // Prints every registered lock to the debugger
+
+ private:
+  friend class crt::static_local<lock_profile_registry>;
+
+  lock_profile_registry() noexcept = default;
+
+ private:
+  spin_lock<> m_lock;
+  th::details::lock_profile* m_head{nullptr};
+};
+
+#ifdef KTL_ENABLE_LOCK_PROFILING
+template <class Mutex>
+class profiled : public Mutex {
+ public:
+  using MyBase = Mutex;
+  using counter_type = th::details::lock_profile::counter_type;
+
+  // Without try_lock() a wait longer than this is considered contended
+  static constexpr counter_type CONTENTION_THRESHOLD{1};
+
+ public:
+  template <class... Types>
+  explicit profiled(const char* name, Types&&... args)
+      : MyBase(forward<Types>(args)...), m_profile{name} {}
+
+  template <class... OwnerHandle>
+  void lock(OwnerHandle&... owner_handle) {
+    const auto start{now()};
+    bool contended;
+    if constexpr (sizeof...(OwnerHandle) == 0 &&
+                  th::details::has_try_lock_v<Mutex>) {
+      contended = !MyBase::try_lock();
+      if (contended) {
+        MyBase::lock();
+      }
+    } else {
+      MyBase::lock(owner_handle...);
+      contended = now() - start > CONTENTION_THRESHOLD;
+    }
+    const auto acquired_at{now()};
+    on_owned(acquired_at);
+    m_profile.on_acquired(acquired_at - start, contended);
+  }
+
+  template <class Mtx = Mutex,
+            enable_if_t<th::details::has_try_lock_v<Mtx>, int> = 0>
+  bool try_lock() {
+    if (!MyBase::try_lock()) {
+      return false;
+    }
+    on_owned(now());
+    m_profile.on_acquired(0, false);
+    return true;
+  }
+
+  template <class... OwnerHandle>
+  void unlock(OwnerHandle&... owner_handle) {
+    if (--m_depth == 0) {
+      m_profile.on_released(now() - m_acquired_at);
+    }
+    MyBase::unlock(owner_handle...);
+  }
+
+  template <class Mtx = Mutex>
+  auto lock_shared() -> decltype(declval<Mtx&>().lock_shared()) {
+    const auto start{now()};
+    MyBase::lock_shared();
+    const auto wait_time{now() - start};
+    m_profile.on_acquired(wait_time, wait_time > CONTENTION_THRESHOLD);
+  }
+
+  [[nodiscard]] lock_statistics get_statistics() const noexcept {
+    return m_profile.get_statistics();
+  }
+
+ private:
+  static counter_type now() noexcept {
+    return th::details::lock_profile::now();
+  }
+
+  // A recursive mutex is held from the outermost acquisition
+  void on_owned(counter_type acquired_at) noexcept {
+    if (m_depth++ == 0) {
+      m_acquired_at = acquired_at;
+    }
+  }
+
+ private:
+  th::details::lock_profile m_profile;
+  counter_type m_acquired_at{0};
+  uint32_t m_depth{0};  // Touched only by the owner
+};
+#else
+template <class Mutex>
+class profiled : public Mutex {
+ public:
+  using MyBase = Mutex;
+
+ public:
+  template <class... Types>
+  explicit profiled(const char*, Types&&... args)
+      : MyBase(forward<Types>(args)...) {}
+};
+#endif
+}  // namespace ktl
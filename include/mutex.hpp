@@ -1,8 +1,11 @@
 #pragma once
+#include <atomic.hpp>
 #include <basic_types.hpp>
 #include <chrono.hpp>
 #include <compressed_pair.hpp>
+#include <functional.hpp>
 #include <irql.hpp>
+#include <percpu.hpp>
 #include <thread.hpp>
 #include <tuple.hpp>
 #include <type_traits.hpp>
@@ -154,7 +157,7 @@ class spin_lock_base : non_relocatable {
   compressed_pair<LockPolicy, KSPIN_LOCK> m_storage;
 };
 
-enum class SpinlockType { Mixed, DpcOnly };
+enum class SpinlockType { Mixed, DpcOnly, Interrupt };
 
 template <SpinlockType Type>
 class spin_lock_policy_base {
@@ -167,6 +170,10 @@ class spin_lock_policy_base<SpinlockType::DpcOnly> {};
 
 template <SpinlockType Type>
 struct spin_lock_policy : spin_lock_policy_base<Type> {
+  static_assert(Type != SpinlockType::Interrupt,
+                "Interrupt spinlocks are bound to KINTERRUPT, "
+                "use interrupt_spin_lock");
+
   void lock(KSPIN_LOCK& target) const noexcept;
   bool try_lock(KSPIN_LOCK& target) const noexcept;
   void unlock(KSPIN_LOCK& target) const noexcept;
@@ -174,6 +181,9 @@ struct spin_lock_policy : spin_lock_policy_base<Type> {
 
 template <SpinlockType Type>
 struct queued_spin_lock_policy {
+  static_assert(Type != SpinlockType::Interrupt,
+                "Interrupt spinlocks can't be queued, use interrupt_spin_lock");
+
   void lock(KSPIN_LOCK& target,
             KLOCK_QUEUE_HANDLE& queue_handle) const noexcept;
   void unlock(KLOCK_QUEUE_HANDLE& queue_handle) const noexcept;
@@ -189,7 +199,9 @@ template <uint8_t>
 struct spin_lock_selector_impl;
 
 template <>
-struct spin_lock_selector_impl<INTERRUPT_SPIN_LOCK>;  // Unsupported now
+struct spin_lock_selector_impl<INTERRUPT_SPIN_LOCK> {
+  static constexpr SpinlockType value = SpinlockType::Interrupt;
+};
 
 template <>
 struct spin_lock_selector_impl<NORMAL_SPIN_LOCK> {
@@ -210,13 +222,14 @@ template <irql_t MinIrql, irql_t MaxIrql>
 struct spin_lock_type_selector {
   static_assert(MinIrql <= MaxIrql,
                 "Invalid spinlock type: MinIrql must be less or equal MaxIrql");
-  static_assert(MaxIrql <= DISPATCH_LEVEL,
-                "Interrupt spinlocks are unsupported now");
 
-  static constexpr SpinlockType value =
-      spin_lock_selector_impl<static_cast<uint8_t>(MinIrql <= APC_LEVEL) |
-                              (static_cast<uint8_t>(MaxIrql <= DISPATCH_LEVEL)
-                               << 1)>::value;
+  static constexpr uint8_t INDEX{
+      MaxIrql <= DISPATCH_LEVEL
+          ? static_cast<uint8_t>(static_cast<uint8_t>(MinIrql <= APC_LEVEL) |
+                                 (static_cast<uint8_t>(1) << 1))
+          : INTERRUPT_SPIN_LOCK};
+
+  static constexpr SpinlockType value = spin_lock_selector_impl<INDEX>::value;
 };
 
 template <irql_t MinIrql, irql_t MaxIrql>
@@ -270,6 +283,146 @@ struct queued_spin_lock
   using MyBase::native_handle;
 };
 
+namespace th::details {
+// Each shared owner raised IRQL on its own, so the previous IRQLs are kept
+// per processor: an owner can't migrate while the lock is held
+template <SpinlockType Type>
+class shared_spin_lock_irql_storage {
+ protected:
+  irql_t& get_shared_irql() noexcept {  // Valid only at DISPATCH_LEVEL
+    return m_shared_irqls.local();
+  }
+
+ protected:
+  irql_t m_exclusive_irql{};
+
+ private:
+  percpu<irql_t> m_shared_irqls;
+};
+
+template <>
+class shared_spin_lock_irql_storage<SpinlockType::DpcOnly> {};
+}  // namespace th::details
+
+template <irql_t MinIrql = PASSIVE_LEVEL, irql_t MaxIrql = DISPATCH_LEVEL>
+class shared_spin_lock  // Wrapper for EX_SPIN_LOCK
+    : public th::details::sync_primitive_base<EX_SPIN_LOCK>,
+      th::details::shared_spin_lock_irql_storage<
+          th::details::spin_lock_type_v<MinIrql, MaxIrql>> {
+ public:
+  using MyBase = th::details::sync_primitive_base<EX_SPIN_LOCK>;
+
+ private:
+  static constexpr bool IS_DPC_ONLY{
+      th::details::spin_lock_type_v<MinIrql, MaxIrql> ==
+      th::details::SpinlockType::DpcOnly};
+
+  static_assert(MaxIrql <= DISPATCH_LEVEL,
+                "EX_SPIN_LOCK can't be acquired above DISPATCH_LEVEL");
+
+ public:
+  shared_spin_lock() { MyBase::m_native_sp = 0; }
+
+  void lock() noexcept {
+    if constexpr (IS_DPC_ONLY) {
+      ExAcquireSpinLockExclusiveAtDpcLevel(native_handle());
+    } else {
+      this->m_exclusive_irql = ExAcquireSpinLockExclusive(native_handle());
+    }
+  }
+
+  void unlock() noexcept {
+    if constexpr (IS_DPC_ONLY) {
+      ExReleaseSpinLockExclusiveFromDpcLevel(native_handle());
+    } else {
+      ExReleaseSpinLockExclusive(native_handle(), this->m_exclusive_irql);
+    }
+  }
+
+  void lock_shared() noexcept {
+    if constexpr (IS_DPC_ONLY) {
+      ExAcquireSpinLockSharedAtDpcLevel(native_handle());
+    } else {
+      const irql_t prev_irql{ExAcquireSpinLockShared(native_handle())};
+      this->get_shared_irql() = prev_irql;
+    }
+  }
+
+  void unlock_shared() noexcept {
+    if constexpr (IS_DPC_ONLY) {
+      ExReleaseSpinLockSharedFromDpcLevel(native_handle());
+    } else {
+      ExReleaseSpinLockShared(native_handle(), this->get_shared_irql());
+    }
+  }
+
+  // On success the caller owns the lock exclusively and must call unlock()
+  [[nodiscard]] bool try_convert_shared_to_exclusive() noexcept {
+    if (!ExTryConvertSharedSpinLockExclusive(native_handle())) {
+      return false;
+    }
+    if constexpr (!IS_DPC_ONLY) {
+      this->m_exclusive_irql = this->get_shared_irql();
+    }
+    return true;
+  }
+
+  using MyBase::native_handle;
+};
+
+// Interrupt spin lock of a connected KINTERRUPT: serializes code running
+// at IRQL <= DISPATCH_LEVEL with the ISR. The ISR itself already holds
+// the lock and mustn't acquire it
+class interrupt_spin_lock : non_relocatable {
+ public:
+  using native_handle_type = PKINTERRUPT;
+
+ public:
+  interrupt_spin_lock() noexcept = default;
+  explicit interrupt_spin_lock(PKINTERRUPT interrupt) noexcept
+      : m_interrupt{interrupt} {}
+
+  void bind(PKINTERRUPT interrupt) noexcept {  // After IoConnectInterruptEx()
+    m_interrupt = interrupt;
+  }
+
+  void lock() noexcept {
+    m_prev_irql = KeAcquireInterruptSpinLock(m_interrupt);
+  }
+
+  void unlock() noexcept {
+    KeReleaseInterruptSpinLock(m_interrupt, m_prev_irql);
+  }
+
+  // Runs fn at DIRQL under the lock, like KeSynchronizeExecution()
+  template <class Fn>
+  bool synchronize(Fn&& fn) noexcept {
+    // The routine casts the context back to the cv-qualified type of fn
+    auto* context{const_cast<void*>(
+        static_cast<const volatile void*>(addressof(fn)))};
+    return KeSynchronizeExecution(m_interrupt, &synchronize_routine<Fn>,
+                                  context) != 0;
+  }
+
+  native_handle_type native_handle() noexcept { return m_interrupt; }
+
+ private:
+  template <class Fn>
+  static BOOLEAN NTAPI synchronize_routine(void* context) noexcept {
+    auto& fn{*static_cast<remove_reference_t<Fn>*>(context)};
+    if constexpr (is_void_v<invoke_result_t<Fn&>>) {
+      invoke(fn);
+      return true;
+    } else {
+      return static_cast<bool>(invoke(fn));
+    }
+  }
+
+ private:
+  PKINTERRUPT m_interrupt{nullptr};
+  irql_t m_prev_irql{};
+};
+
 struct semaphore : th::details::sync_primitive_base<KSEMAPHORE> {
   using MyBase = sync_primitive_base<KSEMAPHORE>;
   using counter_type = long;
@@ -403,6 +556,46 @@ struct notify_event : th::details::event_with_fixed_type<NotificationEvent> {
   using MyBase::MyBase;
 };
 
+// Spins with exponential backoff for a bounded time unless the owner has
+// acquired the mutex on the current processor, then parks on an event. Like
+// fast_mutex, the owner runs with normal kernel APCs disabled.
+// Non-recursive, PASSIVE_LEVEL..APC_LEVEL
+class adaptive_mutex : non_relocatable {
+ public:
+  struct statistics {  // Contended acquisitions only
+    size_t spin_acquisitions;
+    size_t blocking_acquisitions;
+  };
+
+ private:
+  enum state_type : uint32_t { unlocked, locked, locked_with_waiters };
+
+ public:
+  static constexpr uint32_t SPIN_LIMIT{4096};  // In YieldProcessor() calls
+  static constexpr uint32_t MAX_BACKOFF{64};
+
+ public:
+  adaptive_mutex() noexcept = default;
+
+  void lock() noexcept;
+  bool try_lock() noexcept;
+  void unlock() noexcept;
+
+  [[nodiscard]] statistics get_statistics() const noexcept;
+
+ private:
+  bool try_acquire() noexcept;
+  bool try_lock_spinning() noexcept;
+  bool is_owner_on_current_processor() const noexcept;
+
+ private:
+  atomic<uint32_t> m_state{unlocked};
+  atomic<uint32_t> m_owner_processor{0};
+  sync_event m_event;
+  atomic_size_t m_spin_acquisitions{0};
+  atomic_size_t m_blocking_acquisitions{0};
+};
+
 namespace th::details {
 template <class Lockable, class Rep, class Period, class = void>
 struct has_lock_for : false_type {};
@@ -683,8 +876,8 @@ class shared_lock : public th::details::mutex_guard_base<Mutex> {
 
   using MyBase::release;
 
-  void lock() { MyBase::lock_shared; }
-  void unlock() { MyBase::unlock_shared; }
+  void lock() { MyBase::lock_shared(); }
+  void unlock() { MyBase::unlock_shared(); }
 
  private:
   void reset_if_needed() noexcept {
@@ -0,0 +1,87 @@
+#pragma once
+#include <algorithm.hpp>
+#include <assert.hpp>
+#include <atomic.hpp>
+#include <basic_types.hpp>
+#include <functional.hpp>
+#include <irql.hpp>
+#include <percpu.hpp>
+#include <type_traits.hpp>
+#include <utility.hpp>
+
+#include <ntddk.h>
+
+namespace ktl {
+namespace th::details {
+using broadcast_routine_t = void (*)(void* context,
+                                     uint32_t processor_index) noexcept;
+
+// Runs routine on every active processor at DISPATCH_LEVEL through the
+// kernel's generic call DPC and returns once all of them have passed the
+// final barrier. Concurrent broadcasts are serialized by the kernel
+void broadcast_dpc(broadcast_routine_t routine, void* context) noexcept;
+
+uint32_t get_active_processor_count() noexcept;
+}  // namespace th::details
+
+// Calls fn(processor_index) on each active processor at DISPATCH_LEVEL.
+// Must be called at PASSIVE_LEVEL; fn must neither block nor throw
+template <class Fn>
+void parallel_on_each_cpu(Fn&& fn) noexcept {
+  assert_with_msg(get_current_irql() == PASSIVE_LEVEL,
+                  "parallel_on_each_cpu() must be called at PASSIVE_LEVEL");
+  using fn_type = remove_reference_t<Fn>;
+  th::details::broadcast_dpc(
+      [](void* context, uint32_t processor_index) noexcept {
+        invoke(*static_cast<fn_type*>(context), processor_index);
+      },
+      const_cast<remove_const_t<fn_type>*>(addressof(fn)));
+}
+
+// Stores fn(processor_index) into the slot of each processor
+template <class Ty, class Fn>
+void parallel_on_each_cpu(percpu<Ty>& results, Fn&& fn) noexcept {
+  parallel_on_each_cpu([&results, &fn](uint32_t processor_index) noexcept {
+    results.local() = invoke(fn, processor_index);  // Runs on its processor
+  });
+}
+
+// Calls fn(idx) for each idx in [first, last). Processors claim the indices
+// in chunks, so a processor delayed by interrupts doesn't hold up the rest
+template <class Fn>
+void parallel_for(size_t first, size_t last, Fn&& fn) noexcept {
+  if (first >= last) {
+    return;
+  }
+  constexpr size_t CHUNKS_PER_PROCESSOR{4};
+  const size_t count{last - first};
+  const size_t chunk_count{th::details::get_active_processor_count() *
+                           CHUNKS_PER_PROCESSOR};
+  const size_t chunk_size{(max)(count / chunk_count, size_t{1})};
+
+  atomic<size_t> next_chunk{0};
+  parallel_on_each_cpu([&](uint32_t) noexcept {
+    for (;;) {
+      const size_t chunk_first{next_chunk.fetch_add<memory_order_relaxed>(1) *
+                               chunk_size};
+      if (chunk_first >= count) {
+        break;
+      }
+      const size_t chunk_last{(min)(chunk_first + chunk_size, count)};
+      for (size_t idx = chunk_first; idx < chunk_last; ++idx) {
+        invoke(fn, first + idx);
+      }
+    }
+  });
+}
+
+// Calls fn(element) for each element of a random access range
+template <class Range, class Fn>
+void parallel_for(Range& range, Fn&& fn) noexcept {
+  auto range_first{range.begin()};
+  parallel_for(size_t{0}, static_cast<size_t>(range.end() - range_first),
+               [&range_first, &fn](size_t idx) noexcept {
+                 invoke(fn, range_first[idx]);
+               });
+}
+}  // namespace ktl
@@ -0,0 +1,184 @@
+#pragma once
+#include <allocator.hpp>
+#include <atomic.hpp>
+#include <basic_types.hpp>
+#include <functional.hpp>
+#include <heap.hpp>
+#include <irql.hpp>
+#include <memory_impl.hpp>
+#include <type_traits.hpp>
+#include <utility.hpp>
+
+#include <ntddk.h>
+
+namespace ktl {
+// Keeps the current thread on its processor. Can be entered at
+// IRQL <= DISPATCH_LEVEL
+class dispatch_level_guard : non_relocatable {
+ public:
+  dispatch_level_guard() noexcept
+      : m_prev_irql{raise_irql(DISPATCH_LEVEL)} {}
+  ~dispatch_level_guard() noexcept { lower_irql(m_prev_irql); }
+
+ private:
+  irql_t m_prev_irql;
+};
+
+// One cache line padded slot per processor. The slot count is the maximum
+// processor count across all groups, so hot-added processors have slots too
+template <class Ty>
+class percpu : non_relocatable {
+ public:
+  using value_type = Ty;
+  using size_type = uint32_t;
+
+ private:
+  struct alignas(crt::CACHE_LINE_SIZE) slot {
+    template <class... Types>
+    explicit slot(Types&&... args) : value(forward<Types>(args)...) {}
+
+    Ty value;
+  };
+
+  using allocator_type =
+      aligned_non_paged_allocator<slot, crt::CACHE_LINE_ALLOCATION_ALIGNMENT>;
+
+ public:
+  template <class... Types>
+  explicit percpu(const Types&... args)  // Every slot gets a copy of args
+      : m_size{KeQueryMaximumProcessorCountEx(ALL_PROCESSOR_GROUPS)},
+        m_slots{allocator_type{}.allocate(m_size)} {
+    size_type constructed{0};
+    try {
+      for (; constructed < m_size; ++constructed) {
+        construct_at(m_slots + constructed, args...);
+      }
+    } catch (...) {
+      destroy(constructed);
+      throw;
+    }
+  }
+
+  ~percpu() noexcept { destroy(m_size); }
+
+  // The thread may migrate right after the call unless it runs at
+  // DISPATCH_LEVEL, so the slot must be safe to touch from other processors
+  [[nodiscard]] Ty& local() noexcept {
+    return m_slots[get_current_index()].value;
+  }
+
+  [[nodiscard]] const Ty& local() const noexcept {
+    return m_slots[get_current_index()].value;
+  }
+
+  template <class Fn>
+  decltype(auto) with_local(Fn&& fn) {  // fn is called at DISPATCH_LEVEL
+    dispatch_level_guard guard;
+    return invoke(forward<Fn>(fn), local());
+  }
+
+  [[nodiscard]] Ty& operator[](size_type idx) noexcept {
+    return m_slots[idx].value;
+  }
+
+  [[nodiscard]] const Ty& operator[](size_type idx) const noexcept {
+    return m_slots[idx].value;
+  }
+
+  [[nodiscard]] size_type size() const noexcept { return m_size; }
+
+  template <class Fn>
+  void for_each(Fn fn) {
+    for (size_type idx = 0; idx < m_size; ++idx) {
+      fn(m_slots[idx].value);
+    }
+  }
+
+  template <class Fn>
+  void for_each(Fn fn) const {
+    for (size_type idx = 0; idx < m_size; ++idx) {
+      fn(static_cast<const Ty&>(m_slots[idx].value));
+    }
+  }
+
+ private:
+  void destroy(size_type constructed) noexcept {  // Also frees the buffer
+    for (size_type idx = 0; idx < constructed; ++idx) {
+      m_slots[idx].~slot();
+    }
+    allocator_type{}.deallocate(m_slots, m_size);
+  }
+
+  size_type get_current_index() const noexcept {
+    // The index is unique system-wide and never exceeds the maximum count,
+    // the modulo only guards against a count changed by hot-add
+    return KeGetCurrentProcessorNumberEx(nullptr) % m_size;
+  }
+
+ private:
+  size_type m_size;
+  slot* m_slots;
+};
+
+// Counter updated on the local processor only and summed on read().
+// read() isn't a snapshot: concurrent updates may be partially visible
+template <class Ty = int64_t>
+class sharded_counter : non_relocatable {
+ public:
+  using value_type = Ty;
+
+  static_assert(is_integral_v<Ty>, "sharded_counter requires integral type");
+
+ public:
+  sharded_counter() : m_shards(value_type{0}) {}
+
+  void add(value_type value) noexcept {
+    // The thread may migrate after local(), so another processor can
+    // occasionally write the slot and the RMW must stay atomic. The line
+    // rarely bounces and no ordering is needed for a sum
+    m_shards.local().fetch_add<memory_order_relaxed>(value);
+  }
+
+  void sub(value_type value) noexcept { add(static_cast<value_type>(-value)); }
+
+  sharded_counter& operator++() noexcept {
+    add(1);
+    return *this;
+  }
+
+  sharded_counter& operator--() noexcept {
+    sub(1);
+    return *this;
+  }
+
+  sharded_counter& operator+=(value_type value) noexcept {
+    add(value);
+    return *this;
+  }
+
+  sharded_counter& operator-=(value_type value) noexcept {
+    sub(value);
+    return *this;
+  }
+
+  [[nodiscard]] value_type read() const noexcept {
+    value_type sum{0};
+    m_shards.for_each([&sum](const atomic<value_type>& shard) {
+      sum += shard.load<memory_order_relaxed>();
+    });
+    return sum;
+  }
+
+  value_type reset() noexcept {  // Returns the value dropped
+    value_type sum{0};
+    m_shards.for_each(
+        [&sum](atomic<value_type>& shard) { sum += shard.exchange(0); });
+    return sum;
+  }
+
+  operator value_type() const noexcept { return read(); }
+
+ private:
+  percpu<atomic<value_type> > m_shards;
+};
+}  // namespace ktl
@@ -0,0 +1,144 @@
+#pragma once
+#include <assert.hpp>
+#include <atomic.hpp>
+#include <irql.hpp>
+#include <mutex.hpp>
+#include <new_delete.hpp>
+#include <smart_pointer.hpp>
+#include <type_traits.hpp>
+#include <utility.hpp>
+
+#include <ntddk.h>
+
+namespace ktl {
+// Blocks until every processor has passed through a quiescent state, i.e.
+// all read-side critical sections started before the call have finished.
+// Must be called at IRQL <= APC_LEVEL
+void synchronize_rcu() noexcept;
+
+// Read-side critical section: the processor isn't preempted while it's held,
+// so no shared memory is written. Can be entered at IRQL <= DISPATCH_LEVEL
+class rcu_read_guard : non_relocatable {
+ public:
+  rcu_read_guard() noexcept : m_prev_irql{raise_irql(DISPATCH_LEVEL)} {}
+  ~rcu_read_guard() noexcept { lower_irql(m_prev_irql); }
+
+ private:
+  irql_t m_prev_irql;
+};
+
+template <class Ty>
+class rcu_reader : non_copyable {  // Snapshot valid until destruction
+ public:
+  using element_type = Ty;
+  using pointer = const Ty*;
+  using reference = const Ty&;
+
+ public:
+  template <class Loader>
+  explicit rcu_reader(Loader loader) noexcept : m_ptr{loader()} {}
+
+  [[nodiscard]] pointer get() const noexcept { return m_ptr; }
+
+  [[nodiscard]] reference operator*() const noexcept {
+    assert_with_msg(m_ptr, "dereferencing an empty rcu snapshot");
+    return *m_ptr;
+  }
+
+  [[nodiscard]] pointer operator->() const noexcept { return get(); }
+
+  explicit operator bool() const noexcept { return m_ptr != nullptr; }
+
+ private:
+  rcu_read_guard m_guard;  // Must be entered before the pointer is loaded
+  pointer m_ptr;
+};
+
+// Read-copy-update pointer: readers take a snapshot without any atomic RMW,
+// writers publish a new version and free the old one after a grace period.
+// Readers dereference the object at DISPATCH_LEVEL, so Ty and everything it
+// owns must reside in non-paged memory. Writers are serialized by an internal
+// mutex and must run at IRQL <= APC_LEVEL
+template <class Ty, class Deleter = mm::details::default_delete<Ty> >
+class rcu_ptr : non_relocatable {
+ public:
+  using element_type = Ty;
+  using deleter_type = Deleter;
+  using pointer = Ty*;
+  using unique_pointer = unique_ptr<Ty, Deleter>;
+  using reader_type = rcu_reader<Ty>;
+
+ public:
+  rcu_ptr() noexcept = default;
+  explicit rcu_ptr(unique_pointer initial) noexcept
+      : m_ptr{initial.release()} {}
+
+  rcu_ptr(const rcu_ptr&) = delete;
+  rcu_ptr& operator=(const rcu_ptr&) = delete;
+
+  ~rcu_ptr() noexcept {
+    // There must be no readers during destruction
+    Deleter{}(m_ptr.load<memory_order_relaxed>());
+  }
+
+  [[nodiscard]] reader_type read_lock() const noexcept {
+    return reader_type{[this] { return load(); }};
+  }
+
+  [[nodiscard]] reader_type snapshot() const noexcept { return read_lock(); }
+
+  // Usable only inside a read-side critical section entered by the caller
+  [[nodiscard]] const Ty* get(const rcu_read_guard&) const noexcept {
+    return load();
+  }
+
+  // Publishes a new version, waits for a grace period and destroys the old one
+  void update(unique_pointer new_value) noexcept {
+    Deleter{}(exchange(move(new_value)).release());
+  }
+
+  void reset() noexcept { update(unique_pointer{}); }
+
+  // Publishes a new version and returns the old one as soon as no reader can
+  // observe it
+  [[nodiscard]] unique_pointer exchange(unique_pointer new_value) noexcept {
+    verify_max_irql(APC_LEVEL);
+    lock_guard guard{m_writer_lock};
+    return publish(move(new_value));
+  }
+
+  // Copies the current version into the non-paged pool, lets updater modify
+  // the copy and publishes it. The copy is made at the caller's IRQL: holding
+  // the writer lock keeps the current version from being retired, so no
+  // read-side critical section is needed
+  template <class Updater>
+  void copy_update(Updater updater) {
+    verify_max_irql(APC_LEVEL);
+    unique_pointer old_value;
+    {
+      lock_guard guard{m_writer_lock};
+      const Ty* current{m_ptr.load<memory_order_relaxed>()};
+      unique_pointer new_value{current ? new (non_paged_new) Ty(*current)
+                                       : new (non_paged_new) Ty{}};
+      updater(*new_value);
+      old_value = publish(move(new_value));
+    }
+    Deleter{}(old_value.release());
+  }
+
+ private:
+  const Ty* load() const noexcept {
+    return m_ptr.load<memory_order_acquire>();  // plain MOV on x86/x64
+  }
+
+  unique_pointer publish(unique_pointer new_value) noexcept {  // Under lock
+    pointer old_value{m_ptr.exchange(new_value.release())};
+    synchronize_rcu();
+    return unique_pointer{old_value};
+  }
+
+ private:
+  atomic<pointer> m_ptr{nullptr};
+  mutex m_writer_lock;
+};
+}  // namespace ktl
@@ -0,0 +1,67 @@
+#pragma once
+#include <basic_types.hpp>
+#include <heap.hpp>
+#include <utility.hpp>
+
+#include <ntddk.h>
+
+namespace ktl {
+// Cache-aware rundown protection: acquire and release touch only the
+// current processor's reference, so every I/O can take it without
+// bouncing a shared counter. Acquisition fails once the rundown started
+class rundown_protection : non_relocatable {
+ public:
+  using native_handle_type = PEX_RUNDOWN_REF_CACHE_AWARE;
+
+ public:
+  explicit rundown_protection(crt::pool_tag_t pool_tag = crt::KTL_HEAP_TAG);
+  ~rundown_protection() noexcept;
+
+  [[nodiscard]] bool try_acquire() noexcept;
+  void release() noexcept;
+
+  // Blocks new acquisitions and waits for the existing ones to be released.
+  // Must be called at IRQL <= APC_LEVEL
+  void wait_for_rundown() noexcept;
+
+  void complete_rundown() noexcept;  // Marks rundown done without waiting
+  void reinitialize() noexcept;      // Allows acquisitions after a rundown
+
+  native_handle_type native_handle() noexcept { return m_ref; }
+
+ private:
+  native_handle_type m_ref;
+};
+
+class rundown_guard : non_copyable {
+ public:
+  explicit rundown_guard(rundown_protection& protection) noexcept
+      : m_protection{protection.try_acquire() ? addressof(protection)
+                                              : nullptr} {}
+
+  rundown_guard(rundown_guard&& other) noexcept
+      : m_protection{exchange(other.m_protection, nullptr)} {}
+
+  rundown_guard& operator=(rundown_guard&& other) noexcept {
+    if (this != addressof(other)) {
+      reset();
+      m_protection = exchange(other.m_protection, nullptr);
+    }
+    return *this;
+  }
+
+  ~rundown_guard() noexcept { reset(); }
+
+  [[nodiscard]] bool owns() const noexcept { return m_protection != nullptr; }
+  explicit operator bool() const noexcept { return owns(); }
+
+  void reset() noexcept {
+    if (auto* protection = exchange(m_protection, nullptr); protection) {
+      protection->release();
+    }
+  }
+
+ private:
+  rundown_protection* m_protection;
+};
+}  // namespace ktl
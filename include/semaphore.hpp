@@ -0,0 +1,87 @@
+#pragma once
+#include <assert.hpp>
+#include <atomic.hpp>
+#include <basic_types.hpp>
+#include <chrono.hpp>
+#include <limits.hpp>
+#include <thread.hpp>
+
+#include <ntddk.h>
+
+namespace ktl {
+// Lightweight semaphore built on atomic waiting, unlike the KSEMAPHORE
+// wrapper in mutex.hpp. Acquiring may block only at IRQL <= APC_LEVEL
+template <ptrdiff_t LeastMaxValue = (numeric_limits<ptrdiff_t>::max)()>
+class counting_semaphore : non_relocatable {
+ public:
+  static_assert(LeastMaxValue >= 0,
+                "counting_semaphore requires non-negative max value");
+
+ public:
+  static constexpr ptrdiff_t(max)() noexcept { return LeastMaxValue; }
+
+ public:
+  explicit counting_semaphore(ptrdiff_t desired) noexcept
+      : m_counter{desired} {
+    assert_with_msg(desired >= 0 && desired <= LeastMaxValue,
+                    "initial semaphore counter is out of range");
+  }
+
+  void release(ptrdiff_t update = 1) noexcept {
+    const auto prev{m_counter.fetch_add(update)};
+    assert_with_msg(update >= 0 && prev <= LeastMaxValue - update,
+                    "semaphore counter overflow");
+    if (update == 1) {
+      m_counter.notify_one();
+    } else {
+      m_counter.notify_all();
+    }
+  }
+
+  void acquire() noexcept {
+    while (!try_acquire()) {
+      m_counter.wait<memory_order_relaxed>(0);
+    }
+  }
+
+  [[nodiscard]] bool try_acquire() noexcept {
+    auto current{m_counter.load<memory_order_relaxed>()};
+    while (current > 0) {
+      if (m_counter.compare_exchange_strong<memory_order_acquire>(
+              current, current - 1)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  template <class Rep, class Period>
+  [[nodiscard]] bool try_acquire_for(
+      const chrono::duration<Rep, Period>& wait_duration) noexcept {
+    return try_acquire_until(chrono::steady_clock::now() + wait_duration);
+  }
+
+  template <class Clock, class Duration>
+  [[nodiscard]] bool try_acquire_until(
+      const chrono::time_point<Clock, Duration>& awake_time) noexcept {
+    while (!try_acquire()) {
+      if (!wait_until(awake_time)) {
+        return try_acquire();
+      }
+    }
+    return true;
+  }
+
+ private:
+  template <class Clock, class Duration>
+  bool wait_until(
+      const chrono::time_point<Clock, Duration>& awake_time) noexcept {
+    return m_counter.wait_until(0, awake_time);
+  }
+
+ private:
+  atomic<ptrdiff_t> m_counter;
+};
+
+using binary_semaphore = counting_semaphore<1>;
+}  // namespace ktl
@@ -0,0 +1,119 @@
+#pragma once
+#include <atomic.hpp>
+#include <backoff.hpp>
+#include <basic_types.hpp>
+#include <compressed_pair.hpp>
+#include <intrinsic.hpp>
+#include <mutex.hpp>
+#include <type_traits.hpp>
+#include <utility.hpp>
+
+#include <ntddk.h>
+
+namespace ktl {
+// Sequence counter for embedding into bigger structures. Writers must be
+// serialized by the caller; readers never write to shared memory
+class seqcount : non_relocatable {
+ public:
+  using sequence_type = uint32_t;
+
+ public:
+  constexpr seqcount() noexcept = default;
+
+  [[nodiscard]] sequence_type read_begin() const noexcept {
+    for (;;) {
+      const auto sequence{m_sequence.load<memory_order_acquire>()};
+      if (!is_write_in_progress(sequence)) {
+        return sequence;
+      }
+      YieldProcessor();
+    }
+  }
+
+  [[nodiscard]] bool read_retry(sequence_type start) const noexcept {
+    atomic_thread_fence<memory_order_acquire>();  // Data loads can't sink below
+    return m_sequence.load<memory_order_relaxed>() != start;
+  }
+
+  void write_begin() noexcept {
+    // Writers are serialized, so there is no need in atomic RMW
+    const auto sequence{m_sequence.load<memory_order_relaxed>()};
+    m_sequence.store<memory_order_relaxed>(sequence + 1);
+    atomic_thread_fence<memory_order_release>();  // Data stores can't hoist
+  }
+
+  void write_end() noexcept {
+    const auto sequence{m_sequence.load<memory_order_relaxed>()};
+    m_sequence.store<memory_order_release>(sequence + 1);
+  }
+
+ private:
+  static constexpr bool is_write_in_progress(sequence_type sequence) noexcept {
+    return (sequence & 1) != 0;
+  }
+
+ private:
+  atomic<sequence_type> m_sequence{0};
+};
+
+struct null_lock {  // For seqlocks serialized by the owner
+  void lock() noexcept {}
+  bool try_lock() noexcept { return true; }
+  void unlock() noexcept {}
+};
+
+template <class Ty,
+          class Lock = spin_lock<>,
+          class Backoff = exponential_backoff<> >
+class seqlock : non_relocatable {
+ public:
+  using value_type = Ty;
+  using lock_type = Lock;
+  using backoff_type = Backoff;
+
+  static_assert(is_trivially_copyable_v<Ty>,
+                "seqlock<Ty> requires Ty to be trivially copyable");
+
+ public:
+  template <class U = Ty, enable_if_t<is_default_constructible_v<U>, int> = 0>
+  seqlock() noexcept(is_nothrow_default_constructible_v<Ty>) {}
+
+  explicit seqlock(const Ty& value) noexcept : m_value{value} {}
+
+  [[nodiscard]] Ty read() const noexcept {
+    aligned_storage_t<sizeof(Ty), alignof(Ty)> buffer;
+    Backoff backoff;
+    for (;;) {
+      const auto sequence{get_seqcount().read_begin()};
+      memcpy(addressof(buffer), addressof(m_value), sizeof(Ty));
+      if (!get_seqcount().read_retry(sequence)) {
+        break;
+      }
+      backoff.pause();  // Let the writer finish instead of racing it again
+    }
+    return *reinterpret_cast<Ty*>(addressof(buffer));
+  }
+
+  void store(const Ty& new_value) noexcept {
+    write([&new_value](Ty& value) { value = new_value; });
+  }
+
+  template <class Modifier>
+  void write(Modifier modifier) noexcept {
+    lock_guard guard{get_lock()};
+    get_seqcount().write_begin();
+    modifier(m_value);
+    get_seqcount().write_end();
+  }
+
+  lock_type& get_lock() noexcept { return m_sync.get_first(); }
+
+ private:
+  seqcount& get_seqcount() noexcept { return m_sync.get_second(); }
+  const seqcount& get_seqcount() const noexcept { return m_sync.get_second(); }
+
+ private:
+  compressed_pair<lock_type, seqcount> m_sync{};
+  Ty m_value{};
+};
+}  // namespace ktl
@@ -11,7 +11,22 @@
 namespace ktl {
 using thread_id_t = uint32_t;
 
+// Processor identified by its group and its number within the group
+struct processor_number {
+  // processor_index is a system-wide index below hardware_concurrency()
+  static processor_number from_index(uint32_t processor_index);
+
+  [[nodiscard]] uint32_t to_index() const noexcept;
+  [[nodiscard]] bool is_valid() const noexcept;
+
+  uint16_t group{0};
+  uint8_t number{0};
+};
+
 namespace th::details {
+// Throws kernel_error if the processor doesn't exist
+void verify_processor(const processor_number& processor);
+
 template <class Rep, class Period, class AwaitHandler>
 constexpr NTSTATUS wait_for_impl(
     const chrono::duration<Rep, Period>& wait_duration,
@@ -43,6 +58,9 @@ thread_id_t get_id();
 
 void yield() noexcept;
 
+// Binds the current thread to a single processor
+void set_affinity(const processor_number& processor);
+
 template <class Rep, class Period>
 void sleep_for(const chrono::duration<Rep, Period>& sleep_duration) {
   th::details::wait_for_impl(sleep_duration, [](LARGE_INTEGER* interval) {
@@ -104,6 +122,11 @@ class thread_base : non_copyable {
   priority_t get_priority() const noexcept;
   priority_t set_priority(priority_t new_priority) noexcept;
 
+  void set_affinity(const processor_number& processor);
+  void set_affinity(uint16_t group, KAFFINITY mask);  // Processors of a group
+  void set_ideal_processor(const processor_number& processor);
+
+  // Active processors in all groups
   static uint32_t hardware_concurrency() noexcept;
 
  protected:
@@ -119,6 +142,32 @@ class thread_base : non_copyable {
   internal_object_type m_thread{};
 };
 
+struct thread_slots;
+
+// Publishes the thread_specific slot table of a thread started by
+// worker_thread. The table is torn down by release() before the thread exits
+class thread_slots_scope : non_relocatable {
+ public:
+  thread_slots_scope() noexcept;
+  ~thread_slots_scope() noexcept { release(); }
+
+  void release() noexcept;
+
+ private:
+  thread_slots* m_slots;
+};
+
+// Binds the new thread before the user's callable runs
+struct bound_call {
+  template <class Fn, class... Types>
+  decltype(auto) operator()(Fn&& fn, Types&&... args) const {
+    this_thread::set_affinity(processor);
+    return invoke(forward<Fn>(fn), forward<Types>(args)...);
+  }
+
+  processor_number processor;
+};
+
 template <class ConcreteThread>
 class worker_thread : public thread_base {
  public:
@@ -173,13 +222,17 @@ class worker_thread : public thread_base {
   template <class ArgTuple, size_t... Indices>
   static void invoke_in_thread(void* raw_args) noexcept {
     auto* args_ptr{static_cast<ArgTuple*>(raw_args)};
+    thread_slots_scope slots;  // before_exit() may never return
     using invoke_result_t = decltype(
         invoke_with_unpacked_args<ArgTuple, Indices...>(unique_ptr{args_ptr}));
     if constexpr (!is_void_v<invoke_result_t>) {
-      accessor::before_exit(invoke_with_unpacked_args<ArgTuple, Indices...>(
-          unique_ptr{args_ptr}));
+      auto result{invoke_with_unpacked_args<ArgTuple, Indices...>(
+          unique_ptr{args_ptr})};
+      slots.release();
+      accessor::before_exit(move(result));
     } else {
       invoke_with_unpacked_args<ArgTuple, Indices...>(unique_ptr{args_ptr});
+      slots.release();
       accessor::before_exit();
     }
   }
@@ -200,7 +253,9 @@ class system_thread : public th::details::worker_thread<system_thread> {
  public:
   constexpr system_thread() noexcept = default;
 
-  template <class Fn, class... Types>
+  template <class Fn,
+            class... Types,
+            enable_if_t<!is_same_v<decay_t<Fn>, processor_number>, int> = 0>
   explicit system_thread(irql_t max_irql, Fn&& fn, Types&&... args)
       : MyBase(
             create_thread(max_irql, forward<Fn>(fn), forward<Types>(args)...)) {
@@ -209,7 +264,11 @@ class system_thread : public th::details::worker_thread<system_thread> {
                     "join() and detach() are not available");
   }
 
-  template <class Fn, class... Types>
+  // Constrained so that a processor_number argument selects the bound
+  // overloads below instead of being treated as the callable
+  template <class Fn,
+            class... Types,
+            enable_if_t<!is_same_v<decay_t<Fn>, processor_number>, int> = 0>
   explicit system_thread(Fn&& fn, Types&&... args)
       : MyBase(create_thread(PASSIVE_LEVEL,
                              forward<Fn>(fn),
@@ -219,6 +278,34 @@ class system_thread : public th::details::worker_thread<system_thread> {
                     "join() and detach() are not available");
   }
 
+  // The thread is bound to the processor before fn is called
+  template <class Fn, class... Types>
+  explicit system_thread(const processor_number& processor,
+                         irql_t max_irql,
+                         Fn&& fn,
+                         Types&&... args)
+      : MyBase(create_bound_thread(processor,
+                                   max_irql,
+                                   forward<Fn>(fn),
+                                   forward<Types>(args)...)) {
+    assert_with_msg(native_handle(),
+                    "opening thread failed; thread is running but get_id(), "
+                    "join() and detach() are not available");
+  }
+
+  template <class Fn, class... Types>
+  explicit system_thread(const processor_number& processor,
+                         Fn&& fn,
+                         Types&&... args)
+      : MyBase(create_bound_thread(processor,
+                                   PASSIVE_LEVEL,
+                                   forward<Fn>(fn),
+                                   forward<Types>(args)...)) {
+    assert_with_msg(native_handle(),
+                    "opening thread failed; thread is running but get_id(), "
+                    "join() and detach() are not available");
+  }
+
   system_thread(system_thread&&) noexcept = default;
   system_thread& operator=(system_thread&&) noexcept = default;
   ~system_thread() noexcept;
@@ -251,6 +338,18 @@ class system_thread : public th::details::worker_thread<system_thread> {
     return thread_obj;
   }
 
+  template <class Fn, class... Types>
+  static internal_object_type create_bound_thread(
+      const processor_number& processor,
+      irql_t max_irql,
+      Fn&& fn,
+      Types&&... args) {
+    // Binding can't fail in the new thread
+    th::details::verify_processor(processor);
+    return create_thread(max_irql, th::details::bound_call{processor},
+                         forward<Fn>(fn), forward<Types>(args)...);
+  }
+
   static internal_object_type create_thread_impl(thread_routine_t start,
                                                  void* raw_args);
 
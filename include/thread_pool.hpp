@@ -0,0 +1,128 @@
+#pragma once
+#include <allocator.hpp>
+#include <assert.hpp>
+#include <atomic.hpp>
+#include <basic_types.hpp>
+#include <functional.hpp>
+#include <heap.hpp>
+#include <mutex.hpp>
+#include <new_delete.hpp>
+#include <semaphore.hpp>
+#include <smart_pointer.hpp>
+#include <thread.hpp>
+#include <tuple.hpp>
+#include <type_traits.hpp>
+#include <utility.hpp>
+
+#include <ntddk.h>
+
+namespace ktl {
+namespace th::details {
+struct pool_task {
+  using routine_t = void (*)(pool_task*) noexcept;  // Runs and frees the task
+
+  pool_task* prev;
+  pool_task* next;
+  routine_t run_and_destroy;
+};
+
+template <class ArgTuple>
+struct packed_pool_task : pool_task {
+  template <class... Types>
+  explicit packed_pool_task(Types&&... args_)
+      : pool_task{nullptr, nullptr, &run_and_destroy_impl},
+        args{forward<Types>(args_)...} {}
+
+  // Like in system_thread, an exception escaping the task terminates
+  static void run_and_destroy_impl(pool_task* task) noexcept {
+    unique_ptr<packed_pool_task> guard{static_cast<packed_pool_task*>(task)};
+    apply(
+        [](auto&&... args) {
+          invoke(forward<decltype(args)>(args)...);  // args[0] is fn
+        },
+        move(guard->args));
+  }
+
+  ArgTuple args;
+};
+
+// Intrusive deque: the owner pushes and pops at the back, thieves and the
+// injection queue consumers take from the front
+class task_deque : non_relocatable {
+ public:
+  void push_back(pool_task* task) noexcept;
+  [[nodiscard]] pool_task* pop_back() noexcept;
+  [[nodiscard]] pool_task* pop_front() noexcept;
+
+  // Racy hint which lets thieves skip empty deques without taking the lock
+  [[nodiscard]] bool empty() const noexcept {
+    return m_size.load<memory_order_relaxed>() == 0;
+  }
+
+ private:
+  void unlink(pool_task* task) noexcept;
+
+ private:
+  spin_lock<> m_lock;
+  pool_task* m_head{nullptr};
+  pool_task* m_tail{nullptr};
+  atomic<uint32_t> m_size{0};
+};
+}  // namespace th::details
+
+// Fixed set of system threads executing submitted callables. Each worker owns
+// a deque; tasks submitted from a worker go to its own deque, others go to
+// the shared injection queue, and idle workers steal before they park
+class thread_pool : non_relocatable {
+ public:
+  using size_type = uint32_t;
+
+ private:
+  struct alignas(crt::CACHE_LINE_SIZE) worker {
+    th::details::task_deque tasks;
+    atomic<thread_id_t> owner_id{0};
+    system_thread thread;
+  };
+
+  using allocator_type =
+      aligned_non_paged_allocator<worker, crt::CACHE_LINE_ALLOCATION_ALIGNMENT>;
+
+ public:
+  // One worker bound to each active processor
+  thread_pool();
+
+  // Worker idx is bound to the processor with the index
+  // idx % hardware_concurrency() unless affinitize is false
+  explicit thread_pool(size_type worker_count, bool affinitize = true);
+
+  // Runs the tasks already submitted and joins the workers. Must be called
+  // at PASSIVE_LEVEL outside of the pool's workers
+  ~thread_pool() noexcept;
+
+  // May be called at IRQL <= DISPATCH_LEVEL. Accepts the same callables as
+  // system_thread; the arguments are decay-copied into non-paged memory
+  template <class Fn, class... Types>
+  void submit(Fn&& fn, Types&&... args) {
+    using task_type =
+        th::details::packed_pool_task<tuple<decay_t<Fn>, decay_t<Types>...> >;
+    push(new (non_paged_new)
+             task_type{forward<Fn>(fn), forward<Types>(args)...});
+  }
+
+  [[nodiscard]] size_type size() const noexcept { return m_worker_count; }
+
+ private:
+  void destroy() noexcept;
+  void run_remaining_tasks() noexcept;
+  void push(th::details::pool_task* task) noexcept;
+  th::details::pool_task* find_task(size_type worker_idx) noexcept;
+  void worker_routine(size_type worker_idx) noexcept;
+
+ private:
+  size_type m_worker_count;
+  worker* m_workers;
+  th::details::task_deque m_injection_queue;
+  counting_semaphore<> m_pending{0};  // One permit per queued task
+  atomic<bool> m_stopping{false};
+};
+}  // namespace ktl
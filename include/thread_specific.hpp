@@ -0,0 +1,96 @@
+#pragma once
+#include <basic_types.hpp>
+#include <functional.hpp>
+#include <ktlexcept.hpp>
+#include <new_delete.hpp>
+#include <percpu.hpp>
+#include <thread.hpp>
+#include <type_traits.hpp>
+#include <utility.hpp>
+
+#include <ntddk.h>
+
+namespace ktl {
+namespace th::details {
+inline constexpr uint32_t MAX_THREAD_SLOTS{64};
+
+struct thread_slot {
+  using deleter_t = void (*)(void* value) noexcept;
+
+  void* value{nullptr};
+  deleter_t deleter{nullptr};
+  uint32_t generation{0};  // Tells values of a reused key apart
+};
+
+struct thread_slots {
+  thread_slot slots[MAX_THREAD_SLOTS];
+};
+
+struct thread_slot_key {
+  uint32_t index;
+  uint32_t generation;
+};
+
+// nullptr unless the current thread was started by worker_thread
+thread_slots* get_current_thread_slots() noexcept;
+
+thread_slot_key allocate_thread_slot_key();
+void free_thread_slot_key(thread_slot_key key) noexcept;
+}  // namespace th::details
+
+// Per-thread value for threads started by system_thread, io_thread and
+// the like. The value is default-constructed on first access and destroyed
+// when the thread exits. Foreign threads fall back to a per-processor value
+template <class Ty>
+class thread_specific : non_relocatable {
+ public:
+  using value_type = Ty;
+
+ public:
+  thread_specific() : m_key{th::details::allocate_thread_slot_key()} {}
+
+  // Values of running threads are destroyed when the threads exit
+  ~thread_specific() noexcept { th::details::free_thread_slot_key(m_key); }
+
+  // nullptr in foreign threads or if the value can't be allocated
+  [[nodiscard]] Ty* get() {
+    auto* slots{th::details::get_current_thread_slots()};
+    if (!slots) {
+      return nullptr;
+    }
+    auto& slot{slots->slots[m_key.index]};
+    if (slot.generation != m_key.generation) {
+      if (slot.value) {
+        slot.deleter(slot.value);  // Left by a destroyed thread_specific
+        slot.value = nullptr;
+      }
+      slot.value = new (nothrow_t{}, non_paged_new) Ty();
+      if (!slot.value) {
+        return nullptr;
+      }
+      slot.deleter = &delete_value;
+      slot.generation = m_key.generation;
+    }
+    return static_cast<Ty*>(slot.value);
+  }
+
+  // Calls fn with the value of the current thread. In foreign threads
+  // fn is called with the processor's value at DISPATCH_LEVEL
+  template <class Fn>
+  decltype(auto) with(Fn&& fn) {
+    if (auto* value = get(); value) {
+      return invoke(forward<Fn>(fn), *value);
+    }
+    return m_fallback.with_local(forward<Fn>(fn));
+  }
+
+ private:
+  static void delete_value(void* value) noexcept {
+    delete static_cast<Ty*>(value);
+  }
+
+ private:
+  th::details::thread_slot_key m_key;
+  percpu<Ty> m_fallback;
+};
+}  // namespace ktl
@@ -0,0 +1,133 @@
+#pragma once
+#include <assert.hpp>
+#include <basic_types.hpp>
+#include <chrono.hpp>
+#include <mutex.hpp>
+#include <type_traits.hpp>
+
+#include <ntddk.h>
+
+namespace ktl {
+namespace th::details {
+struct timer_link {  // Node of a circular list with a sentinel head
+  timer_link* prev{nullptr};
+  timer_link* next{nullptr};
+};
+}  // namespace th::details
+
+class timer_wheel;
+
+// Intrusive timer. The entry must outlive its scheduling and must not be
+// destroyed while its callback may be running
+class timer_entry : th::details::timer_link, non_relocatable {
+ public:
+  // Called at DISPATCH_LEVEL with no locks held, so it may reschedule
+  // the entry. Callbacks of one batch may run on several processors
+  using callback_t = void (*)(timer_entry& entry) noexcept;
+
+ public:
+  explicit constexpr timer_entry(callback_t callback) noexcept
+      : m_callback{callback} {}
+
+  // Racy unless the caller serializes it with schedule() and cancel()
+  [[nodiscard]] bool is_scheduled() const noexcept { return next != nullptr; }
+
+ private:
+  friend class timer_wheel;
+
+  uint64_t m_expiry_tick{0};
+  callback_t m_callback;
+};
+
+// Hierarchical timer wheel driven by a single periodic KTIMER. schedule(),
+// cancel() and reschedule() are O(1) and may be called at
+// IRQL <= DISPATCH_LEVEL. Timers never expire early, but may be late by up to
+// a tick plus the DPC latency. Must reside in non-paged memory
+class timer_wheel : non_relocatable {
+ public:
+  using tick_type = uint64_t;
+
+  static constexpr uint32_t SLOT_BITS{6};
+  static constexpr uint32_t SLOT_COUNT{1u << SLOT_BITS};
+  static constexpr uint32_t LEVEL_COUNT{4};
+
+  // Longer timeouts are parked in the last level and cascaded again
+  static constexpr tick_type MAX_DIRECT_TICKS{tick_type{1}
+                                              << (SLOT_BITS * LEVEL_COUNT)};
+
+ private:
+  using link_type = th::details::timer_link;
+
+  static constexpr tick_type SLOT_MASK{SLOT_COUNT - 1};
+
+ public:
+  // The KTIMER period is the tick rounded down to whole milliseconds
+  // (at least 1 ms); expiry is computed from the interrupt time, so a
+  // coarser or late timer only delays the batch
+  template <class Rep, class Period>
+  explicit timer_wheel(const chrono::duration<Rep, Period>& tick_duration)
+      : m_tick_tics{chrono::duration_cast<chrono::tics>(tick_duration)
+                        .count()} {
+    assert_with_msg(m_tick_tics > 0, "timer wheel tick must be positive");
+    start();
+  }
+
+  ~timer_wheel() noexcept;  // Pending timers are dropped without firing
+
+  template <class Rep, class Period>
+  void schedule(timer_entry& entry,
+                const chrono::duration<Rep, Period>& timeout) noexcept {
+    schedule_ticks(entry, to_ticks(timeout));
+  }
+
+  // Returns true if the entry was pending
+  template <class Rep, class Period>
+  bool reschedule(timer_entry& entry,
+                  const chrono::duration<Rep, Period>& timeout) noexcept {
+    return reschedule_ticks(entry, to_ticks(timeout));
+  }
+
+  // Returns false if the timer has already fired or its callback is running
+  bool cancel(timer_entry& entry) noexcept;
+
+  [[nodiscard]] chrono::tics get_tick_duration() const noexcept {
+    return chrono::tics{m_tick_tics};
+  }
+
+ private:
+  template <class Rep, class Period>
+  tick_type to_ticks(
+      const chrono::duration<Rep, Period>& timeout) const noexcept {
+    const auto tics{chrono::ceil<chrono::tics>(timeout).count()};
+    if (tics <= 0) {
+      return 0;
+    }
+    return static_cast<tick_type>((tics + m_tick_tics - 1) / m_tick_tics);
+  }
+
+  void start() noexcept;
+  void schedule_ticks(timer_entry& entry, tick_type ticks) noexcept;
+  bool reschedule_ticks(timer_entry& entry, tick_type ticks) noexcept;
+
+  tick_type get_elapsed_ticks() const noexcept;
+  void insert(timer_entry& entry) noexcept;
+  void process_tick() noexcept;
+  void cascade(uint32_t level) noexcept;
+  void expire() noexcept;
+
+  static void NTAPI dpc_routine(KDPC*,
+                                void* context,
+                                void* system_argument1,
+                                void* system_argument2) noexcept;
+
+ private:
+  int64_t m_tick_tics;
+  uint64_t m_start_time{0};  // Interrupt time in 100 ns units
+  tick_type m_current_tick{0};  // Next tick to be processed
+  spin_lock<> m_lock;
+  link_type m_wheel[LEVEL_COUNT][SLOT_COUNT];
+  link_type m_expired;  // Fired but not yet called back
+  KTIMER m_timer;
+  KDPC m_dpc;
+};
+}  // namespace ktl
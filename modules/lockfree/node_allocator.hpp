@@ -7,6 +7,7 @@
 #include <algorithm.hpp>
 #include <allocator.hpp>
 #include <atomic.hpp>
+#include <backoff.hpp>
 #include <type_traits.hpp>
 #include <utility.hpp>
 
@@ -16,10 +17,12 @@ namespace ktl::lockfree {
 template <class Ty,
           align_val_t Align,
           template <typename, align_val_t>
-          class BasicNodeAllocator>
+          class BasicNodeAllocator,
+          class Backoff = exponential_backoff<> >
 class node_allocator {
  public:
   using value_type = Ty;
+  using backoff_type = Backoff;
   using size_type = size_t;
   using difference_type = ptrdiff_t;
 
@@ -93,6 +96,7 @@ class node_allocator {
     auto& head{get_head()};
     auto old_top_value{head.load<memory_order_consume>()};
 
+    Backoff backoff;
     Ty* ptr{nullptr};
     while (!ptr) {
       auto old_top{node_pointer{old_top_value}};
@@ -106,6 +110,8 @@ class node_allocator {
         // old_top_value may be rewritten
         if (head.compare_exchange_weak(old_top_value, new_pool.get_value())) {
           ptr = reinterpret_cast<Ty*>(old_top.get_pointer());
+        } else {
+          backoff.pause();
         }
       }
     }
@@ -118,6 +124,7 @@ class node_allocator {
 
     auto* new_top_ptr = reinterpret_cast<memory_block_header*>(ptr);
 
+    Backoff backoff;
     for (;;) {
       node_pointer new_top{new_top_ptr, node_pointer{old_top_value}.get_tag()};
       new_top->next = old_top_value;
@@ -126,6 +133,7 @@ class node_allocator {
       if (head.compare_exchange_weak(old_top_value, new_top.get_value())) {
         break;
       }
+      backoff.pause();
     }
   }
 
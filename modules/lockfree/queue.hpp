@@ -5,6 +5,7 @@
 #include <allocator.hpp>
 #include <assert.hpp>
 #include <atomic.hpp>
+#include <backoff.hpp>
 #include <basic_types.hpp>
 #include <crt_attributes.hpp>
 #include <limits.hpp>
@@ -13,10 +14,14 @@
 #include <ntddk.h>
 
 namespace ktl::lockfree {
-template <class Ty, template <typename, align_val_t> class BasicNodeAllocator>
+template <class Ty,
+          template <typename, align_val_t>
+          class BasicNodeAllocator,
+          class Backoff = exponential_backoff<> >
 class mpmc_queue : public non_relocatable {  // multi-producer, multi-consumer
  public:
   using value_type = Ty;
+  using backoff_type = Backoff;
   using reference = Ty&;
   using const_reference = const Ty&;
   using pointer = Ty*;
@@ -56,7 +61,8 @@ class mpmc_queue : public non_relocatable {  // multi-producer, multi-consumer
   using internal_allocator_type =
       node_allocator<node,
                      static_cast<align_val_t>(NODE_ALIGNMENT),
-                     BasicNodeAllocator>;
+                     BasicNodeAllocator,
+                     Backoff>;
   using allocator_traits_type = allocator_traits<internal_allocator_type>;
 
  public:
@@ -103,6 +109,7 @@ class mpmc_queue : public non_relocatable {  // multi-producer, multi-consumer
   bool push(const OtherTy& value) {
     auto* new_node{create_data_node(value)};
 
+    Backoff backoff;
     for (;;) {
       auto tail{node_pointer{m_tail.get_ptr().load<memory_order_acquire>()}};
       node* tail_ptr{tail.get_pointer()};
@@ -123,6 +130,7 @@ class mpmc_queue : public non_relocatable {  // multi-producer, multi-consumer
           cas_strong_helper(m_tail.get_ptr(), tail, new_tail);
         }
       }
+      backoff.pause();  // Lost the race to another producer
     }
   }
 
@@ -131,6 +139,7 @@ class mpmc_queue : public non_relocatable {  // multi-producer, multi-consumer
                             is_nothrow_assignable_v<OtherTy&, Ty>,
                         int> = 0>
   bool pop(OtherTy& value) {
+    Backoff backoff;
     for (;;) {
       auto head{node_pointer{m_head.get_ptr().load<memory_order_acquire>()}};
       node* head_ptr{head.get_pointer()};
@@ -166,6 +175,7 @@ class mpmc_queue : public non_relocatable {  // multi-producer, multi-consumer
           }
         }
       }
+      backoff.pause();
     }
   }
 
@@ -282,9 +292,9 @@ class mpmc_queue : public non_relocatable {  // multi-producer, multi-consumer
   internal_allocator_type m_alc{};
 };  // namespace ktl::lockfree
 
-template <class Ty>
-using queue = mpmc_queue<Ty, aligned_paged_allocator>;
+template <class Ty, class Backoff = exponential_backoff<> >
+using queue = mpmc_queue<Ty, aligned_paged_allocator, Backoff>;
 
-template <class Ty>
-using queue_non_paged = mpmc_queue<Ty, aligned_non_paged_allocator>;
+template <class Ty, class Backoff = exponential_backoff<> >
+using queue_non_paged = mpmc_queue<Ty, aligned_non_paged_allocator, Backoff>;
 }  // namespace ktl::lockfree
@@ -1,4 +1,5 @@
 ﻿#pragma once
+#include <brlock.hpp>
 #include <mutex.hpp>
 #include <type_traits.hpp>
 #include <utility.hpp>
@@ -66,8 +67,14 @@ template <class Ty>
 using synchronized =
     th::details::synchronized<Ty, recursive_mutex, lock_guard, lock_guard>;
 
-template <class Ty>
+template <class Ty, class SharedMutex = shared_mutex>
 using synchronized_shared =
-    th::details::synchronized<Ty, shared_mutex, shared_lock, lock_guard>;
+    th::details::synchronized<Ty, SharedMutex, shared_lock, lock_guard>;
+
+template <class Ty>
+using synchronized_spin_shared = synchronized_shared<Ty, shared_spin_lock<> >;
+
+template <class Ty>
+using synchronized_brlock = synchronized_shared<Ty, brlock>;
 
 }  // namespace ktl
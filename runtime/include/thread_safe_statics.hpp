@@ -0,0 +1,73 @@
+#pragma once
+#include <basic_types.hpp>
+#include <crt_attributes.hpp>
+#include <placement_new.hpp>
+#include <type_traits_impl.hpp>
+#include <utility_impl.hpp>
+
+#include <ntddk.h>
+
+// MSVC thread-safe statics ABI. A guard is 0 before initialization, -1 while
+// it's in progress and the value of the global epoch after completion.
+// The compiler-generated fast path compares the guard with the thread-local
+// _Init_thread_epoch, and implicit TLS isn't available to drivers, so code
+// must still be built with /Zc:threadSafeInit- and use crt::static_local
+EXTERN_C int _Init_global_epoch;
+
+EXTERN_C void CRTCALL _Init_thread_header(int* guard) noexcept;
+EXTERN_C void CRTCALL _Init_thread_footer(int* guard) noexcept;
+EXTERN_C void CRTCALL _Init_thread_abort(int* guard) noexcept;
+
+namespace ktl::crt {
+// Lazily initialized object for function-local statics. Constant-initialized
+// itself, so the compiler emits no guard for it. After initialization get()
+// is a single acquire load without any atomic RMW. Ty is never destroyed,
+// so it must be trivially destructible
+template <class Ty>
+class static_local {
+ public:
+  static_assert(is_trivially_destructible_v<Ty>,
+                "static_local<Ty> requires trivially destructible Ty");
+
+  static constexpr int UNINITIALIZED{0}, BEING_INITIALIZED{-1};
+
+ public:
+  constexpr static_local() noexcept = default;
+  static_local(const static_local&) = delete;
+  static_local& operator=(const static_local&) = delete;
+
+  template <class... Types>
+  Ty& get(Types&&... args) {
+    if (!is_initialized()) {
+      initialize(forward<Types>(args)...);
+    }
+    return *reinterpret_cast<Ty*>(m_storage);
+  }
+
+ private:
+  bool is_initialized() const noexcept {
+    const int guard{*static_cast<const volatile int*>(&m_guard)};
+    _ReadWriteBarrier();  // Acquire on x86 and x64
+    return guard != UNINITIALIZED && guard != BEING_INITIALIZED;
+  }
+
+  template <class... Types>
+  NOINLINE void initialize(Types&&... args) {
+    _Init_thread_header(&m_guard);
+    if (m_guard != BEING_INITIALIZED) {
+      return;  // Initialized by another thread while we were waiting
+    }
+    try {
+      ::new (static_cast<void*>(m_storage)) Ty(forward<Types>(args)...);
+    } catch (...) {
+      _Init_thread_abort(&m_guard);
+      throw;
+    }
+    _Init_thread_footer(&m_guard);
+  }
+
+ private:
+  int m_guard{UNINITIALIZED};
+  alignas(Ty) unsigned char m_storage[sizeof(Ty)]{};
+};
+}  // namespace ktl::crt
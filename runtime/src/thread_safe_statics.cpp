@@ -0,0 +1,82 @@
+#include <thread_safe_statics.hpp>
+
+#include <crt_assert.hpp>
+#include <limits_impl.hpp>
+
+#include <ntddk.h>
+
+EXTERN_C int _Init_global_epoch{INT_MIN};  // Initialized guards are <= epoch
+
+namespace ktl::crt {
+namespace details {
+// Waiters park on their own stack events, so nothing here needs dynamic
+// initialization and the ABI is usable during global construction
+struct static_init_waiter {
+  int* guard;
+  static_init_waiter* next;
+  KEVENT event;
+};
+
+static KSPIN_LOCK static_init_lock{0};
+static static_init_waiter* static_init_waiters{nullptr};
+
+static void wake_waiters(int* guard) noexcept {  // Under static_init_lock
+  static_init_waiter** link{&static_init_waiters};
+  while (*link) {
+    auto* waiter{*link};
+    if (waiter->guard == guard) {
+      *link = waiter->next;
+      KeSetEvent(&waiter->event, 0, false);  // waiter may be gone now
+    } else {
+      link = &waiter->next;
+    }
+  }
+}
+}  // namespace details
+}  // namespace ktl::crt
+
+EXTERN_C void CRTCALL _Init_thread_header(int* guard) noexcept {
+  using namespace ktl::crt::details;
+
+  KIRQL prev_irql;
+  KeAcquireSpinLock(&static_init_lock, &prev_irql);
+  while (*guard == -1) {  // Another thread is initializing
+    crt_assert_with_msg(prev_irql <= APC_LEVEL,
+                        "waiting for a static initialization at high IRQL");
+    static_init_waiter waiter{guard, static_init_waiters};
+    KeInitializeEvent(&waiter.event, NotificationEvent, false);
+    static_init_waiters = &waiter;
+    KeReleaseSpinLock(&static_init_lock, prev_irql);
+
+    KeWaitForSingleObject(&waiter.event, Executive, KernelMode, false,
+                          nullptr);
+    KeAcquireSpinLock(&static_init_lock, &prev_irql);
+  }
+  if (*guard == 0) {
+    *guard = -1;  // The caller initializes the object
+  }
+  KeReleaseSpinLock(&static_init_lock, prev_irql);
+}
+
+EXTERN_C void CRTCALL _Init_thread_footer(int* guard) noexcept {
+  using namespace ktl::crt::details;
+
+  KIRQL prev_irql;
+  KeAcquireSpinLock(&static_init_lock, &prev_irql);
+  const long epoch{InterlockedIncrement(
+      reinterpret_cast<volatile long*>(&_Init_global_epoch))};
+  // Publishes the object to the lock-free readers of the guard
+  InterlockedExchange(reinterpret_cast<volatile long*>(guard), epoch);
+  wake_waiters(guard);
+  KeReleaseSpinLock(&static_init_lock, prev_irql);
+}
+
+EXTERN_C void CRTCALL _Init_thread_abort(int* guard) noexcept {
+  using namespace ktl::crt::details;
+
+  KIRQL prev_irql;
+  KeAcquireSpinLock(&static_init_lock, &prev_irql);
+  *guard = 0;  // One of the waiters retries the initialization
+  wake_waiters(guard);
+  KeReleaseSpinLock(&static_init_lock, prev_irql);
+}
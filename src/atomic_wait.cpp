@@ -0,0 +1,159 @@
+#include <atomic.hpp>
+#include <heap.hpp>
+#include <irql.hpp>
+#include <mutex.hpp>
+
+#include <ntddk.h>
+
+namespace ktl::th::details {
+namespace {
+struct wait_node {
+  const volatile void* address;
+  wait_node* next;
+  KEVENT event;
+};
+
+struct alignas(crt::CACHE_LINE_SIZE) wait_bucket {
+  queued_spin_lock<> lock;
+  wait_node* head{nullptr};  // FIFO of waiters parked on the stack
+  wait_node* tail{nullptr};
+  atomic<uint32_t> waiter_count{0};
+};
+
+constexpr size_t WAIT_TABLE_SIZE{256};
+
+wait_bucket wait_table[WAIT_TABLE_SIZE];
+
+wait_bucket& get_bucket(const volatile void* address) noexcept {
+  auto hash{reinterpret_cast<uintptr_t>(address)};
+  hash ^= hash >> 17;
+  hash >>= 3;  // Atomics are naturally aligned
+  return wait_table[hash % WAIT_TABLE_SIZE];
+}
+
+bool is_equal(const volatile void* address,
+              const void* old_value,
+              size_t size) noexcept {
+  switch (size) {
+    case 1:
+      return *static_cast<const volatile uint8_t*>(address) ==
+             *static_cast<const uint8_t*>(old_value);
+    case 2:
+      return *static_cast<const volatile uint16_t*>(address) ==
+             *static_cast<const uint16_t*>(old_value);
+    case 4:
+      return *static_cast<const volatile uint32_t*>(address) ==
+             *static_cast<const uint32_t*>(old_value);
+    default:
+      return *static_cast<const volatile uint64_t*>(address) ==
+             *static_cast<const uint64_t*>(old_value);
+  }
+}
+
+void push_back(wait_bucket& bucket, wait_node& node) noexcept {
+  node.next = nullptr;
+  if (bucket.tail) {
+    bucket.tail->next = addressof(node);
+  } else {
+    bucket.head = addressof(node);
+  }
+  bucket.tail = addressof(node);
+  ++bucket.waiter_count;  // Full barrier before the value is re-checked
+}
+
+void unlink_after(wait_bucket& bucket,
+                  wait_node* prev,
+                  wait_node& node) noexcept {
+  if (prev) {
+    prev->next = node.next;
+  } else {
+    bucket.head = node.next;
+  }
+  if (bucket.tail == addressof(node)) {
+    bucket.tail = prev;
+  }
+  --bucket.waiter_count;
+}
+
+void unlink(wait_bucket& bucket, wait_node& node) noexcept {
+  wait_node* prev{nullptr};
+  for (auto* current = bucket.head; current; current = current->next) {
+    if (current == addressof(node)) {
+      unlink_after(bucket, prev, node);
+      return;
+    }
+    prev = current;
+  }
+}
+}  // namespace
+
+bool atomic_wait_address(const volatile void* address,
+                         const void* old_value,
+                         size_t size,
+                         const LARGE_INTEGER* timeout) noexcept {
+  if (get_current_irql() >= DISPATCH_LEVEL) {
+    for (uint32_t spin = 0; is_equal(address, old_value, size); ++spin) {
+      if (timeout && spin == ATOMIC_WAIT_SPIN_COUNT) {
+        return false;
+      }
+      YieldProcessor();
+    }
+    return true;
+  }
+
+  auto& bucket{get_bucket(address)};
+  wait_node node{address};
+  KeInitializeEvent(addressof(node.event), SynchronizationEvent, false);
+
+  while (is_equal(address, old_value, size)) {
+    {
+      lock_guard guard{bucket.lock};
+      push_back(bucket, node);
+    }
+    if (!is_equal(address, old_value, size)) {
+      // The node may have been already unlinked by a notifier,
+      // which signals the event under the bucket lock
+      lock_guard guard{bucket.lock};
+      unlink(bucket, node);
+      break;
+    }
+    const NTSTATUS status{
+        KeWaitForSingleObject(addressof(node.event), Executive, KernelMode,
+                              false, const_cast<LARGE_INTEGER*>(timeout))};
+    if (status == STATUS_TIMEOUT) {
+      lock_guard guard{bucket.lock};
+      unlink(bucket, node);  // Unless a notifier has raced with the timeout
+      return false;
+    }
+    if (timeout) {
+      break;  // The caller re-checks the value against its deadline
+    }
+  }
+  return true;
+}
+
+void atomic_notify_address(const volatile void* address,
+                           bool notify_all) noexcept {
+  atomic_thread_fence<memory_order_seq_cst>();  // Orders the preceding store
+  auto& bucket{get_bucket(address)};
+  if (!bucket.waiter_count.load<memory_order_relaxed>()) {
+    return;
+  }
+
+  lock_guard guard{bucket.lock};
+  wait_node* prev{nullptr};
+  for (auto* node = bucket.head; node;) {
+    auto* next{node->next};
+    if (node->address != address) {
+      prev = node;
+    } else {
+      unlink_after(bucket, prev, *node);
+      KeSetEvent(addressof(node->event), 0, false);  // node may be gone now
+      if (!notify_all) {
+        break;
+      }
+    }
+    node = next;
+  }
+}
+}  // namespace ktl::th::details
@@ -3,25 +3,76 @@
 namespace ktl {
 namespace th::details {
 void condition_variable_base::notify_one() noexcept {
-  for (;;) {
-    size_t current_wait_count{0};
-    if (current_wait_count = m_wait_count.load<memory_order_acquire>();
-        !current_wait_count) {
-      break;
-    }
-    if (m_wait_count.compare_exchange_strong(current_wait_count,
-                                             current_wait_count - 1)) {
-      m_event.set();
-      break;
-    }
+  if (!m_wait_count.load<memory_order_acquire>()) {
+    return;
+  }
+  lock_guard guard{m_lock};
+  if (auto* node = pop_front(); node) {
+    // A woken waiter returns at once and its node lives on its stack,
+    // so set() must be the last access to the node
+    node->event.set();
   }
 }
 
 void condition_variable_base::notify_all() noexcept {
-  size_t old_wait_count{m_wait_count.exchange(0)};
-  while (old_wait_count--) {
-    m_event.set();
+  if (!m_wait_count.load<memory_order_acquire>()) {
+    return;
+  }
+  lock_guard guard{m_lock};
+  while (auto* node = pop_front()) {
+    node->event.set();  // The last access to the node, as in notify_one()
+  }
+}
+
+NTSTATUS condition_variable_base::await(wait_node& node,
+                                        const LARGE_INTEGER* timeout) noexcept {
+  return KeWaitForSingleObject(node.event.native_handle(), Executive,
+                               KernelMode, false,
+                               const_cast<LARGE_INTEGER*>(timeout));
+}
+
+void condition_variable_base::enqueue(wait_node& node) noexcept {
+  lock_guard guard{m_lock};
+  if (m_tail) {
+    m_tail->next = addressof(node);
+  } else {
+    m_head = addressof(node);
+  }
+  m_tail = addressof(node);
+  ++m_wait_count;
+}
+
+bool condition_variable_base::cancel(wait_node& node) noexcept {
+  lock_guard guard{m_lock};
+  wait_node* prev{nullptr};
+  for (auto* current = m_head; current; current = current->next) {
+    if (current == addressof(node)) {
+      if (prev) {
+        prev->next = node.next;
+      } else {
+        m_head = node.next;
+      }
+      if (m_tail == addressof(node)) {
+        m_tail = prev;
+      }
+      --m_wait_count;
+      return true;
+    }
+    prev = current;
+  }
+  return false;
+}
+
+auto condition_variable_base::pop_front() noexcept -> wait_node* {
+  auto* node{m_head};
+  if (node) {
+    m_head = node->next;
+    if (!m_head) {
+      m_tail = nullptr;
+    }
+    --m_wait_count;
   }
+  return node;
 }
 }  // namespace th::details
-}  // namespace ktl
\ No newline at end of file
+}  // namespace ktl
@@ -0,0 +1,43 @@
+#include <future.hpp>
+
+#include <basic_runtime.hpp>
+
+#include <ntddk.h>
+
+namespace ktl::th::details {
+namespace {
+struct work_item_context {
+  work_routine_t run;
+  work_routine_t finish;
+  void* context;
+};
+
+void NTAPI work_item_routine(void*,
+                             void* raw_work_item,
+                             PIO_WORKITEM work_item) noexcept {
+  // The context lives right after the I/O work item
+  auto* context_ptr{reinterpret_cast<work_item_context*>(
+      static_cast<uint8_t*>(raw_work_item) + IoSizeofWorkItem())};
+  const work_item_context context{*context_ptr};
+  context.run(context.context);
+  IoUninitializeWorkItem(work_item);
+  context.finish(context.context);  // May free the work item's memory
+}
+}  // namespace
+
+size_t get_work_item_size() noexcept {
+  return IoSizeofWorkItem() + sizeof(work_item_context);
+}
+
+void queue_work_item(void* work_item,
+                     work_routine_t run,
+                     work_routine_t finish,
+                     void* context) noexcept {
+  auto* io_work_item{static_cast<PIO_WORKITEM>(work_item)};
+  ::new (static_cast<uint8_t*>(work_item) + IoSizeofWorkItem())
+      work_item_context{run, finish, context};
+  IoInitializeWorkItem(crt::get_driver_object(), io_work_item);
+  IoQueueWorkItemEx(io_work_item, &work_item_routine, DelayedWorkQueue,
+                    work_item);
+}
+}  // namespace ktl::th::details
@@ -0,0 +1,92 @@
+#include <lock_profiler.hpp>
+
+#include <ntddk.h>
+
+namespace ktl {
+namespace th::details {
+lock_profile::lock_profile(const char* name) noexcept : m_name{name} {
+  lock_profile_registry::get_instance().add(*this);
+}
+
+lock_profile::~lock_profile() noexcept {
+  lock_profile_registry::get_instance().remove(*this);
+}
+
+void lock_profile::on_acquired(counter_type wait_time,
+                               bool contended) noexcept {
+  ++m_acquisitions;
+  if (contended) {
+    ++m_contentions;
+  }
+  m_total_wait_time += wait_time;
+  update_max(m_max_wait_time, wait_time);
+}
+
+void lock_profile::on_released(counter_type hold_time) noexcept {
+  m_total_hold_time += hold_time;
+  update_max(m_max_hold_time, hold_time);
+}
+
+lock_statistics lock_profile::get_statistics() const noexcept {
+  return {m_name,
+          m_acquisitions.load<memory_order_relaxed>(),
+          m_contentions.load<memory_order_relaxed>(),
+          m_total_wait_time.load<memory_order_relaxed>(),
+          m_max_wait_time.load<memory_order_relaxed>(),
+          m_total_hold_time.load<memory_order_relaxed>(),
+          m_max_hold_time.load<memory_order_relaxed>()};
+}
+
+void lock_profile::update_max(atomic<counter_type>& target,
+                              counter_type value) noexcept {
+  auto current{target.load<memory_order_relaxed>()};
+  while (current < value && !target.compare_exchange_strong(current, value))
+    ;
+}
+}  // namespace th::details
+
+lock_profile_registry& lock_profile_registry::get_instance() noexcept {
+  static crt::static_local<lock_profile_registry> registry;
+  return registry.get();
+}
+
+void lock_profile_registry::add(th::details::lock_profile& profile) noexcept {
+  lock_guard guard{m_lock};
+  profile.m_next = m_head;
+  if (m_head) {
+    m_head->m_prev = addressof(profile);
+  }
+  m_head = addressof(profile);
+}
+
+void lock_profile_registry::remove(
+    th::details::lock_profile& profile) noexcept {
+  lock_guard guard{m_lock};
+  if (profile.m_prev) {
+    profile.m_prev->m_next = profile.m_next;
+  } else {
+    m_head = profile.m_next;
+  }
+  if (profile.m_next) {
+    profile.m_next->m_prev = profile.m_prev;
+  }
+}
+
+void lock_profile_registry::dump() noexcept {
+  LARGE_INTEGER frequency;
+  KeQueryPerformanceCounter(addressof(frequency));
+  const auto to_us{[ticks_per_second = frequency.QuadPart](uint64_t ticks) {
+    return ticks * 1'000'000 / static_cast<uint64_t>(ticks_per_second);
+  }};
+
+  for_each([&to_us](const lock_statistics& stats) {
+    DbgPrintEx(DPFLTR_DEFAULT_ID, DPFLTR_INFO_LEVEL,
+               "%s: acquired %llu, contended %llu, wait %llu/%llu us, "
+               "hold %llu/%llu us (total/max)\n",
+               stats.name ? stats.name : "<unnamed>", stats.acquisitions,
+               stats.contentions, to_us(stats.total_wait_time),
+               to_us(stats.max_wait_time), to_us(stats.total_hold_time),
+               to_us(stats.max_hold_time));
+  });
+}
+}  // namespace ktl
@@ -69,6 +69,89 @@ void shared_mutex::unlock_shared() noexcept {
   ExReleaseResourceAndLeaveCriticalRegion(native_handle());
 }
 
+void adaptive_mutex::lock() noexcept {
+  // Like fast_mutex and shared_mutex, the owner can't be suspended
+  KeEnterCriticalRegion();
+  if (try_acquire()) {
+    return;
+  }
+  if (try_lock_spinning()) {
+    ++m_spin_acquisitions;
+    return;
+  }
+  // Anyone who finds the mutex locked_with_waiters on unlock() signals the
+  // event, which stays set until a waiter consumes it, so wakeups can't be
+  // lost. The state is left pessimistic after a wakeup
+  while (m_state.exchange(locked_with_waiters) != unlocked) {
+    m_event.wait();
+  }
+  m_owner_processor.store<memory_order_relaxed>(
+      KeGetCurrentProcessorNumberEx(nullptr));
+  ++m_blocking_acquisitions;
+}
+
+bool adaptive_mutex::try_lock() noexcept {
+  KeEnterCriticalRegion();
+  if (try_acquire()) {
+    return true;
+  }
+  KeLeaveCriticalRegion();
+  return false;
+}
+
+void adaptive_mutex::unlock() noexcept {
+  if (m_state.exchange(unlocked) == locked_with_waiters) {
+    m_event.set();
+  }
+  KeLeaveCriticalRegion();
+}
+
+auto adaptive_mutex::get_statistics() const noexcept -> statistics {
+  return {m_spin_acquisitions.load<memory_order_relaxed>(),
+          m_blocking_acquisitions.load<memory_order_relaxed>()};
+}
+
+bool adaptive_mutex::try_acquire() noexcept {
+  uint32_t expected{unlocked};
+  if (!m_state.compare_exchange_strong(expected, locked)) {
+    return false;
+  }
+  m_owner_processor.store<memory_order_relaxed>(
+      KeGetCurrentProcessorNumberEx(nullptr));
+  return true;
+}
+
+bool adaptive_mutex::try_lock_spinning() noexcept {
+  if (KeQueryActiveProcessorCountEx(ALL_PROCESSOR_GROUPS) == 1) {
+    return false;
+  }
+  uint32_t backoff{1};
+  for (uint32_t spin = 0; spin < SPIN_LIMIT; spin += backoff) {
+    const auto state{m_state.load<memory_order_relaxed>()};
+    // The owner's processor is only known as of the acquisition: if it
+    // matches ours, the owner has most likely been preempted by us. An owner
+    // preempted on another processor is spun on until SPIN_LIMIT
+    if (state == locked_with_waiters || is_owner_on_current_processor()) {
+      break;
+    }
+    if (state == unlocked && try_acquire()) {
+      return true;
+    }
+    for (uint32_t idx = 0; idx < backoff; ++idx) {
+      YieldProcessor();
+    }
+    if (backoff < MAX_BACKOFF) {
+      backoff *= 2;
+    }
+  }
+  return false;
+}
+
+bool adaptive_mutex::is_owner_on_current_processor() const noexcept {
+  return m_owner_processor.load<memory_order_relaxed>() ==
+         KeGetCurrentProcessorNumberEx(nullptr);
+}
+
 namespace th::details {
 void spin_lock_policy<SpinlockType::DpcOnly>::lock(
     KSPIN_LOCK& target) const noexcept {
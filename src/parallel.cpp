@@ -0,0 +1,38 @@
+#include <parallel.hpp>
+
+#include <ntddk.h>
+
+// Exported by ntoskrnl but not declared in the WDK headers
+EXTERN_C NTKERNELAPI VOID NTAPI KeGenericCallDpc(PKDEFERRED_ROUTINE routine,
+                                                 PVOID context);
+EXTERN_C NTKERNELAPI VOID NTAPI KeSignalCallDpcDone(PVOID system_argument1);
+EXTERN_C NTKERNELAPI LOGICAL NTAPI
+KeSignalCallDpcSynchronize(PVOID system_argument2);
+
+namespace ktl::th::details {
+namespace {
+struct broadcast_context {
+  broadcast_routine_t routine;
+  void* context;
+};
+
+void NTAPI broadcast_dpc_routine(KDPC*,
+                                 void* deferred_context,
+                                 void* system_argument1,
+                                 void* system_argument2) noexcept {
+  const auto& broadcast{*static_cast<broadcast_context*>(deferred_context)};
+  broadcast.routine(broadcast.context, KeGetCurrentProcessorNumberEx(nullptr));
+  KeSignalCallDpcSynchronize(system_argument2);  // Waits for all processors
+  KeSignalCallDpcDone(system_argument1);
+}
+}  // namespace
+
+void broadcast_dpc(broadcast_routine_t routine, void* context) noexcept {
+  broadcast_context broadcast{routine, context};
+  KeGenericCallDpc(&broadcast_dpc_routine, addressof(broadcast));
+}
+
+uint32_t get_active_processor_count() noexcept {
+  return KeQueryActiveProcessorCountEx(ALL_PROCESSOR_GROUPS);
+}
+}  // namespace ktl::th::details
@@ -0,0 +1,27 @@
+#include <rcu.hpp>
+
+#include <ntddk.h>
+
+namespace ktl {
+void synchronize_rcu() noexcept {
+  // Read-side critical sections run at DISPATCH_LEVEL, so a processor can't be
+  // inside one while the current thread is scheduled on it. Visiting every
+  // processor in turn forces a quiescent state on each of them
+  const ULONG processor_count{
+      KeQueryActiveProcessorCountEx(ALL_PROCESSOR_GROUPS)};
+
+  for (ULONG idx = 0; idx < processor_count; ++idx) {
+    PROCESSOR_NUMBER processor;
+    if (!NT_SUCCESS(KeGetProcessorNumberFromIndex(idx, &processor))) {
+      continue;
+    }
+    GROUP_AFFINITY affinity{};
+    affinity.Group = processor.Group;
+    affinity.Mask = static_cast<KAFFINITY>(1) << processor.Number;
+
+    GROUP_AFFINITY prev_affinity;
+    KeSetSystemGroupAffinityThread(&affinity, &prev_affinity);
+    KeRevertToUserGroupAffinityThread(&prev_affinity);
+  }
+}
+}  // namespace ktl
@@ -0,0 +1,36 @@
+#include <rundown_protection.hpp>
+
+#include <ktlexcept.hpp>
+
+#include <ntddk.h>
+
+namespace ktl {
+rundown_protection::rundown_protection(crt::pool_tag_t pool_tag)
+    : m_ref{ExAllocateCacheAwareRundownProtection(NonPagedPoolNx, pool_tag)} {
+  throw_exception_if_not<bad_alloc>(m_ref);
+}
+
+rundown_protection::~rundown_protection() noexcept {
+  ExFreeCacheAwareRundownProtection(m_ref);
+}
+
+bool rundown_protection::try_acquire() noexcept {
+  return ExAcquireRundownProtectionCacheAware(m_ref) != 0;
+}
+
+void rundown_protection::release() noexcept {
+  ExReleaseRundownProtectionCacheAware(m_ref);
+}
+
+void rundown_protection::wait_for_rundown() noexcept {
+  ExWaitForRundownProtectionReleaseCacheAware(m_ref);
+}
+
+void rundown_protection::complete_rundown() noexcept {
+  ExRundownCompletedCacheAware(m_ref);
+}
+
+void rundown_protection::reinitialize() noexcept {
+  ExReInitializeRundownProtectionCacheAware(m_ref);
+}
+}  // namespace ktl
@@ -1,3 +1,5 @@
+#include <ntifs.h>  // ObOpenObjectByPointer()
+
 #include <bugcheck.hpp>
 #include <thread.hpp>
 #include <ktlexcept.hpp>
@@ -6,6 +8,71 @@
 #include <ntddk.h>
 
 namespace ktl {
+namespace {
+void set_thread_information(HANDLE thread_handle,
+                            THREADINFOCLASS info_class,
+                            void* info,
+                            ULONG info_size) {
+  const NTSTATUS status{
+      ZwSetInformationThread(thread_handle, info_class, info, info_size)};
+  throw_exception_if_not<kernel_error>(NT_SUCCESS(status), status,
+                                       "unable to set thread information");
+}
+
+void set_thread_object_information(void* thread_obj,
+                                   THREADINFOCLASS info_class,
+                                   void* info,
+                                   ULONG info_size) {
+  HANDLE thread_handle;
+  NTSTATUS status{ObOpenObjectByPointer(
+      thread_obj, OBJ_KERNEL_HANDLE, nullptr, THREAD_SET_INFORMATION,
+      *PsThreadType, KernelMode, addressof(thread_handle))};
+  if (NT_SUCCESS(status)) {
+    status = ZwSetInformationThread(thread_handle, info_class, info, info_size);
+    ZwClose(thread_handle);
+  }
+  throw_exception_if_not<kernel_error>(NT_SUCCESS(status), status,
+                                       "unable to set thread information");
+}
+
+GROUP_AFFINITY make_group_affinity(uint16_t group, KAFFINITY mask) noexcept {
+  GROUP_AFFINITY affinity{};
+  affinity.Group = group;
+  affinity.Mask = mask;
+  return affinity;
+}
+
+GROUP_AFFINITY make_group_affinity(const processor_number& processor) noexcept {
+  return make_group_affinity(processor.group,
+                             static_cast<KAFFINITY>(1) << processor.number);
+}
+
+PROCESSOR_NUMBER to_native(const processor_number& processor) noexcept {
+  PROCESSOR_NUMBER native{};
+  native.Group = processor.group;
+  native.Number = processor.number;
+  return native;
+}
+}  // namespace
+
+processor_number processor_number::from_index(uint32_t processor_index) {
+  PROCESSOR_NUMBER native;
+  const NTSTATUS status{
+      KeGetProcessorNumberFromIndex(processor_index, addressof(native))};
+  throw_exception_if_not<kernel_error>(NT_SUCCESS(status), status,
+                                       "invalid processor index");
+  return {native.Group, native.Number};
+}
+
+uint32_t processor_number::to_index() const noexcept {
+  auto native{to_native(*this)};
+  return KeGetProcessorIndexFromNumber(addressof(native));
+}
+
+bool processor_number::is_valid() const noexcept {
+  return to_index() != INVALID_PROCESSOR_INDEX;
+}
+
 namespace this_thread {
 thread_id_t get_id() {
   return HandleToUlong(PsGetCurrentThreadId());
@@ -14,9 +81,22 @@ thread_id_t get_id() {
 void yield() noexcept {
   YieldProcessor();
 }
+
+void set_affinity(const processor_number& processor) {
+  th::details::verify_processor(processor);
+  auto affinity{make_group_affinity(processor)};
+  set_thread_information(ZwCurrentThread(), ThreadGroupInformation,
+                         addressof(affinity), sizeof(affinity));
+}
 }  // namespace this_thread
 
 namespace th::details {
+void verify_processor(const processor_number& processor) {
+  throw_exception_if_not<kernel_error>(processor.is_valid(),
+                                       STATUS_INVALID_PARAMETER,
+                                       "processor doesn't exist");
+}
+
 thread_base::thread_base(internal_object_type thread_obj)
     : m_thread{thread_obj} {}
 
@@ -47,8 +127,27 @@ auto thread_base::get_id() const noexcept -> id {
   return HandleToUlong(PsGetThreadId(native_handle()));
 }
 
+void thread_base::set_affinity(const processor_number& processor) {
+  verify_processor(processor);
+  set_affinity(processor.group, static_cast<KAFFINITY>(1) << processor.number);
+}
+
+void thread_base::set_affinity(uint16_t group, KAFFINITY mask) {
+  auto affinity{make_group_affinity(group, mask)};
+  set_thread_object_information(m_thread, ThreadGroupInformation,
+                                addressof(affinity), sizeof(affinity));
+}
+
+void thread_base::set_ideal_processor(const processor_number& processor) {
+  verify_processor(processor);
+  auto native{to_native(processor)};
+  set_thread_object_information(m_thread, ThreadIdealProcessorEx,
+                                addressof(native), sizeof(native));
+}
+
 uint32_t thread_base::hardware_concurrency() noexcept {
-  return KeQueryActiveProcessorCount(nullptr);
+  // KeQueryActiveProcessorCount() sees the processors of group 0 only
+  return KeQueryActiveProcessorCountEx(ALL_PROCESSOR_GROUPS);
 }
 
 void thread_base::destroy() noexcept {
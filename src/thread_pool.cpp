@@ -0,0 +1,171 @@
+#include <thread_pool.hpp>
+
+#include <memory_impl.hpp>
+
+#include <ntddk.h>
+
+namespace ktl {
+namespace th::details {
+void task_deque::push_back(pool_task* task) noexcept {
+  lock_guard guard{m_lock};
+  task->next = nullptr;
+  task->prev = m_tail;
+  if (m_tail) {
+    m_tail->next = task;
+  } else {
+    m_head = task;
+  }
+  m_tail = task;
+  m_size.store<memory_order_relaxed>(m_size.load<memory_order_relaxed>() + 1);
+}
+
+pool_task* task_deque::pop_back() noexcept {
+  lock_guard guard{m_lock};
+  auto* task{m_tail};
+  if (task) {
+    unlink(task);
+  }
+  return task;
+}
+
+pool_task* task_deque::pop_front() noexcept {
+  lock_guard guard{m_lock};
+  auto* task{m_head};
+  if (task) {
+    unlink(task);
+  }
+  return task;
+}
+
+void task_deque::unlink(pool_task* task) noexcept {
+  if (task->prev) {
+    task->prev->next = task->next;
+  } else {
+    m_head = task->next;
+  }
+  if (task->next) {
+    task->next->prev = task->prev;
+  } else {
+    m_tail = task->prev;
+  }
+  m_size.store<memory_order_relaxed>(m_size.load<memory_order_relaxed>() - 1);
+}
+}  // namespace th::details
+
+thread_pool::thread_pool()
+    : thread_pool(system_thread::hardware_concurrency()) {}
+
+thread_pool::thread_pool(size_type worker_count, bool affinitize)
+    : m_worker_count{worker_count},
+      m_workers{allocator_type{}.allocate(worker_count)} {
+  assert_with_msg(worker_count > 0, "thread pool requires at least one worker");
+  for (size_type idx = 0; idx < m_worker_count; ++idx) {
+    construct_at(m_workers + idx);
+  }
+  try {
+    const auto processor_count{system_thread::hardware_concurrency()};
+    for (size_type idx = 0; idx < m_worker_count; ++idx) {
+      auto& thread{m_workers[idx].thread};
+      if (affinitize) {
+        thread = system_thread{
+            processor_number::from_index(idx % processor_count),
+            &thread_pool::worker_routine, this, idx};
+      } else {
+        thread = system_thread{&thread_pool::worker_routine, this, idx};
+      }
+    }
+  } catch (...) {
+    destroy();  // Stops the workers started so far
+    throw;
+  }
+}
+
+thread_pool::~thread_pool() noexcept {
+  destroy();
+}
+
+void thread_pool::destroy() noexcept {
+  m_stopping.store<memory_order_release>(true);
+  m_pending.release(m_worker_count);  // Every worker gets a permit to exit
+  for (size_type idx = 0; idx < m_worker_count; ++idx) {
+    if (auto& thread = m_workers[idx].thread; thread.joinable()) {
+      thread.join();
+    }
+  }
+  run_remaining_tasks();
+  for (size_type idx = 0; idx < m_worker_count; ++idx) {
+    m_workers[idx].~worker();
+  }
+  allocator_type{}.deallocate(m_workers, m_worker_count);
+}
+
+void thread_pool::run_remaining_tasks() noexcept {
+  // Tasks submitted by other tasks during shutdown may be left behind
+  // by the workers. They run here, on the destroying thread
+  for (bool found = true; found;) {
+    found = false;
+    for (size_type idx = 0; idx <= m_worker_count; ++idx) {
+      auto& tasks{idx < m_worker_count ? m_workers[idx].tasks
+                                       : m_injection_queue};
+      while (auto* task = tasks.pop_front()) {
+        task->run_and_destroy(task);
+        found = true;
+      }
+    }
+  }
+}
+
+void thread_pool::push(th::details::pool_task* task) noexcept {
+  // Workers are bound to processors in index order, so a worker submitting
+  // a task finds itself in the slot of the current processor
+  auto& candidate{
+      m_workers[KeGetCurrentProcessorNumberEx(nullptr) % m_worker_count]};
+  if (candidate.owner_id.load<memory_order_relaxed>() ==
+      this_thread::get_id()) {
+    candidate.tasks.push_back(task);
+  } else {
+    m_injection_queue.push_back(task);
+  }
+  m_pending.release();
+}
+
+th::details::pool_task* thread_pool::find_task(size_type worker_idx) noexcept {
+  if (auto* task = m_workers[worker_idx].tasks.pop_back(); task) {
+    return task;  // The most recent task is likely still in the cache
+  }
+  if (auto* task = m_injection_queue.pop_front(); task) {
+    return task;
+  }
+  for (size_type offset = 1; offset < m_worker_count; ++offset) {
+    auto& victim{m_workers[(worker_idx + offset) % m_worker_count].tasks};
+    if (victim.empty()) {
+      continue;
+    }
+    if (auto* task = victim.pop_front(); task) {
+      return task;  // Steal the oldest one
+    }
+  }
+  return nullptr;
+}
+
+void thread_pool::worker_routine(size_type worker_idx) noexcept {
+  m_workers[worker_idx].owner_id.store<memory_order_relaxed>(
+      this_thread::get_id());
+
+  for (;;) {
+    m_pending.acquire();  // Parks until a task or a shutdown permit arrives
+
+    // A permit guarantees that an unclaimed task exists, but the one
+    // it was released for may be grabbed by a worker scanning ahead of us
+    auto* task{find_task(worker_idx)};
+    while (!task && !m_stopping.load<memory_order_acquire>()) {
+      this_thread::yield();
+      task = find_task(worker_idx);
+    }
+    if (!task) {
+      break;
+    }
+    task->run_and_destroy(task);
+  }
+}
+}  // namespace ktl
@@ -0,0 +1,123 @@
+#include <thread_specific.hpp>
+
+#include <atomic.hpp>
+
+#include <ntddk.h>
+
+namespace ktl::th::details {
+namespace {
+// Two-level table indexed by thread id: O(1) lookup without locks.
+// Thread ids are multiples of 4, so the two lower bits are dropped
+constexpr uint32_t LEAF_BITS{10};
+constexpr uint32_t ROOT_BITS{12};
+constexpr uint32_t LEAF_SIZE{1u << LEAF_BITS};
+constexpr uint32_t ROOT_SIZE{1u << ROOT_BITS};
+
+struct thread_slots_leaf {
+  atomic<thread_slots*> entries[LEAF_SIZE];
+};
+
+class thread_slots_registry : non_relocatable {
+ public:
+  ~thread_slots_registry() noexcept {
+    for (auto& leaf : m_root) {
+      delete leaf.load<memory_order_relaxed>();
+    }
+  }
+
+  thread_slots* find(thread_id_t id) const noexcept {
+    const uint32_t idx{id >> 2};
+    if (idx >> (LEAF_BITS + ROOT_BITS)) {
+      return nullptr;
+    }
+    auto* leaf{m_root[idx >> LEAF_BITS].load<memory_order_acquire>()};
+    return leaf ? leaf->entries[idx & (LEAF_SIZE - 1)]
+                      .load<memory_order_relaxed>()
+                : nullptr;
+  }
+
+  // Only the thread itself writes its entry
+  bool assign(thread_id_t id, thread_slots* slots) noexcept {
+    const uint32_t idx{id >> 2};
+    if (idx >> (LEAF_BITS + ROOT_BITS)) {
+      return false;  // Such threads are treated as foreign
+    }
+    auto& leaf_holder{m_root[idx >> LEAF_BITS]};
+    auto* leaf{leaf_holder.load<memory_order_acquire>()};
+    if (!leaf) {
+      leaf = new (nothrow_t{}, non_paged_new) thread_slots_leaf{};
+      if (!leaf) {
+        return false;
+      }
+      thread_slots_leaf* expected{nullptr};
+      if (!leaf_holder.compare_exchange_strong(expected, leaf)) {
+        delete leaf;  // Leaves are never freed until unload
+        leaf = expected;
+      }
+    }
+    leaf->entries[idx & (LEAF_SIZE - 1)].store<memory_order_relaxed>(slots);
+    return true;
+  }
+
+ private:
+  atomic<thread_slots_leaf*> m_root[ROOT_SIZE]{};
+};
+
+thread_slots_registry registry;
+
+struct slot_key_table {
+  atomic<uint64_t> used_mask{0};
+  atomic<uint32_t> generations[MAX_THREAD_SLOTS]{};
+};
+
+static_assert(MAX_THREAD_SLOTS <= 64, "slot keys are tracked by a 64-bit mask");
+
+slot_key_table slot_keys;
+}  // namespace
+
+thread_slots* get_current_thread_slots() noexcept {
+  return registry.find(this_thread::get_id());
+}
+
+thread_slot_key allocate_thread_slot_key() {
+  auto used{slot_keys.used_mask.load<memory_order_relaxed>()};
+  for (;;) {
+    uint32_t index{0};
+    while (index < MAX_THREAD_SLOTS && (used & (uint64_t{1} << index))) {
+      ++index;
+    }
+    throw_exception_if_not<length_error>(index < MAX_THREAD_SLOTS,
+                                         "no free thread_specific slots");
+    if (slot_keys.used_mask.compare_exchange_weak(
+            used, used | (uint64_t{1} << index))) {
+      return {index, ++slot_keys.generations[index]};
+    }
+  }
+}
+
+void free_thread_slot_key(thread_slot_key key) noexcept {
+  slot_keys.used_mask.fetch_and(~(uint64_t{1} << key.index));
+}
+
+thread_slots_scope::thread_slots_scope() noexcept
+    : m_slots{new (nothrow_t{}, non_paged_new) thread_slots{}} {
+  if (m_slots && !registry.assign(this_thread::get_id(), m_slots)) {
+    delete m_slots;  // The thread runs as a foreign one
+    m_slots = nullptr;
+  }
+}
+
+void thread_slots_scope::release() noexcept {
+  if (!m_slots) {
+    return;
+  }
+  registry.assign(this_thread::get_id(), nullptr);
+  for (auto& slot : m_slots->slots) {
+    if (slot.value) {
+      slot.deleter(slot.value);
+    }
+  }
+  delete m_slots;
+  m_slots = nullptr;
+}
+}  // namespace ktl::th::details
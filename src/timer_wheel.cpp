@@ -0,0 +1,178 @@
+#include <algorithm.hpp>
+#include <timer_wheel.hpp>
+
+#include <ntddk.h>
+
+namespace ktl {
+namespace {
+using link_type = th::details::timer_link;
+
+void make_empty(link_type& head) noexcept {
+  head.prev = addressof(head);
+  head.next = addressof(head);
+}
+
+bool is_empty(const link_type& head) noexcept {
+  return head.next == addressof(head);
+}
+
+void link_tail(link_type& head, link_type& link) noexcept {
+  link.prev = head.prev;
+  link.next = addressof(head);
+  head.prev->next = addressof(link);
+  head.prev = addressof(link);
+}
+
+void unlink(link_type& link) noexcept {
+  link.prev->next = link.next;
+  link.next->prev = link.prev;
+  link.prev = nullptr;
+  link.next = nullptr;
+}
+
+void splice_tail(link_type& to, link_type& from) noexcept {
+  if (is_empty(from)) {
+    return;
+  }
+  from.next->prev = to.prev;
+  to.prev->next = from.next;
+  from.prev->next = addressof(to);
+  to.prev = from.prev;
+  make_empty(from);
+}
+}  // namespace
+
+timer_wheel::~timer_wheel() noexcept {
+  KeCancelTimer(addressof(m_timer));
+  KeFlushQueuedDpcs();  // The DPC may be queued or running on another CPU
+}
+
+bool timer_wheel::cancel(timer_entry& entry) noexcept {
+  lock_guard guard{m_lock};
+  if (!entry.is_scheduled()) {
+    return false;
+  }
+  unlink(entry);
+  return true;
+}
+
+void timer_wheel::start() noexcept {
+  for (auto& level : m_wheel) {
+    for (auto& slot : level) {
+      make_empty(slot);
+    }
+  }
+  make_empty(m_expired);
+
+  constexpr int64_t TICS_PER_MS{10'000};
+  LARGE_INTEGER due_time;
+  due_time.QuadPart = -m_tick_tics;  // A negative value is a relative time
+  const auto period_ms{
+      static_cast<LONG>((max)(m_tick_tics / TICS_PER_MS, int64_t{1}))};
+
+  KeInitializeTimerEx(addressof(m_timer), NotificationTimer);
+  KeInitializeDpc(addressof(m_dpc), &dpc_routine, this);
+  m_start_time = KeQueryInterruptTime();
+  KeSetTimerEx(addressof(m_timer), due_time, period_ms, addressof(m_dpc));
+}
+
+void timer_wheel::schedule_ticks(timer_entry& entry, tick_type ticks) noexcept {
+  lock_guard guard{m_lock};
+  assert_with_msg(!entry.is_scheduled(), "timer is already scheduled");
+  entry.m_expiry_tick = get_elapsed_ticks() + ticks;
+  insert(entry);
+}
+
+bool timer_wheel::reschedule_ticks(timer_entry& entry,
+                                   tick_type ticks) noexcept {
+  lock_guard guard{m_lock};
+  const bool was_pending{entry.is_scheduled()};
+  if (was_pending) {
+    unlink(entry);
+  }
+  entry.m_expiry_tick = get_elapsed_ticks() + ticks;
+  insert(entry);
+  return was_pending;
+}
+
+auto timer_wheel::get_elapsed_ticks() const noexcept -> tick_type {
+  // Tick t is processed once t + 1 ticks have fully elapsed, so an entry
+  // expiring at elapsed + n fires no earlier than n ticks from now
+  return (KeQueryInterruptTime() - m_start_time) /
+         static_cast<uint64_t>(m_tick_tics);
+}
+
+void timer_wheel::insert(timer_entry& entry) noexcept {
+  auto expiry{(max)(entry.m_expiry_tick, m_current_tick)};
+  const auto delta{expiry - m_current_tick};
+  if (delta >= MAX_DIRECT_TICKS) {
+    expiry = m_current_tick + MAX_DIRECT_TICKS - 1;
+  }
+
+  // Level L holds the entries expiring in [64^L, 64^(L+1)) ticks. Their
+  // slot is cascaded to the lower levels when its block of ticks begins
+  uint32_t level{0};
+  while (level + 1 < LEVEL_COUNT &&
+         (expiry - m_current_tick) >> (SLOT_BITS * (level + 1))) {
+    ++level;
+  }
+  const auto slot{(expiry >> (SLOT_BITS * level)) & SLOT_MASK};
+  link_tail(m_wheel[level][slot], entry);
+}
+
+void timer_wheel::process_tick() noexcept {
+  const auto slot{m_current_tick & SLOT_MASK};
+  if (!slot) {
+    cascade(1);
+  }
+  splice_tail(m_expired, m_wheel[0][slot]);
+  ++m_current_tick;
+}
+
+void timer_wheel::cascade(uint32_t level) noexcept {
+  const auto slot{(m_current_tick >> (SLOT_BITS * level)) & SLOT_MASK};
+
+  link_type pending;
+  make_empty(pending);
+  splice_tail(pending, m_wheel[level][slot]);
+  while (!is_empty(pending)) {
+    auto& entry{static_cast<timer_entry&>(*pending.next)};
+    unlink(entry);
+    insert(entry);  // Lands in a lower level unless it was clamped
+  }
+
+  if (!slot && level + 1 < LEVEL_COUNT) {
+    cascade(level + 1);
+  }
+}
+
+void timer_wheel::expire() noexcept {
+  {
+    lock_guard guard{m_lock};
+    const auto elapsed_ticks{get_elapsed_ticks()};
+    while (m_current_tick < elapsed_ticks) {  // The DPC may have been late
+      process_tick();
+    }
+  }
+
+  for (;;) {
+    timer_entry* entry;
+    {
+      lock_guard guard{m_lock};
+      if (is_empty(m_expired)) {
+        break;
+      }
+      entry = addressof(static_cast<timer_entry&>(*m_expired.next));
+      unlink(*entry);
+    }
+    entry->m_callback(*entry);
+  }
+}
+
+void NTAPI timer_wheel::dpc_routine(KDPC*,
+                                    void* context,
+                                    void*,
+                                    void*) noexcept {
+  static_cast<timer_wheel*>(context)->expire();
+}
+}  // namespace ktl